@@ -1,115 +1,429 @@
+#include <algorithm>
 #include <chrono>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "../src/game/moves.hpp"
+#include "../src/perft/perft.hpp"
 #include "../src/util/initializers.hpp"
+#include "../src/util/util.hpp"
+#include "../src/util/zobrist.hpp"
 
-#define DOUBLE_SPACE std::cout << std::endl << std::endl;
+#define DEFAULT_PERFT_DEPTH 6
 
-#define PERFT_DEPTH 8
+const std::string start_fen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
 
-struct DetailedPerftResults
+const std::string usage =
+    "Usage: Phase_perft [options]\n"
+    "  --fen <FEN>       Position to count, the start position if not given\n"
+    "  --depth <n>       Depth to count to (default 6). With --epd, the deepest listed depth to check\n"
+    "  --divide          Print the node count below each root move\n"
+    "  --stats           Also count captures, en passant, castles, promotions, checks and checkmates (slower)\n"
+    "  --threads <n>     Threads to count on (default: all hardware threads)\n"
+    "  --hash <MB>       Share a table of this size between threads to reuse transposed subtrees\n"
+    "  --epd <file>      Check every line of a suite, `<fen> ;D1 20 ;D2 400 ...`, against its expected counts\n"
+    "  --json            Print the results as JSON for tracking over time\n"
+    "  --help, -h        Print this message\n";
+
+struct Options
 {
-  uint64_t captures = 0;
-  uint64_t enpassants = 0;
-  uint64_t castles = 0;
-  uint64_t promotions = 0;
-  uint64_t double_pushes = 0;
-  uint64_t checks = 0;
-  uint64_t checkmates = 0;
+  std::string fen = start_fen;
+  int depth = DEFAULT_PERFT_DEPTH;
+  bool depth_given = false;
+  bool divide = false;
+  bool stats = false;
+  int threads = std::max(1u, std::thread::hardware_concurrency());
+  size_t hash_mb = 0;
+  std::string epd_path;
+  bool json = false;
 };
 
-void display_perft_results(auto duration, int depth, uint64_t total_nodes, DetailedPerftResults detailed_perft_results)
+// One perft of one position, checked against the suite when the suite lists the depth
+struct DepthResult
 {
-  std::cout << "Perft of depth : " << depth << " took: " << duration.count() * (0.000000001) << " seconds."
-            << std::endl;
-  std::cout << "Found " << total_nodes << " total nodes." << std::endl << std::endl;
+  int depth;
+  bool checked;
+  uint64_t expected;
+  perft::PerftResult result;
+  double seconds;
+
+  bool passed() const { return !checked || result.nodes == expected; }
+};
 
-  if (total_nodes > 0)
+struct PositionResult
+{
+  std::string fen;
+  std::vector<DepthResult> depths;
+
+  uint64_t nodes() const
   {
-    std::cout << "Averaged " << (duration.count() / total_nodes) << " ns per move." << std::endl;
-    std::cout << "Generating and classifying at " << 1.0 / ((duration.count() / total_nodes) * (0.000000001))
-              << " valid moves/second." << std::endl;
-    DOUBLE_SPACE
-    std::cout << "Cumulative statistics" << std::endl;
-    std::cout << "--------------------------------------" << std::endl;
-    std::cout << "Captures: " << detailed_perft_results.captures << std::endl;
-    std::cout << "Enpassants: " << detailed_perft_results.enpassants << std::endl;
-    std::cout << "Castles: " << detailed_perft_results.castles << std::endl;
-    std::cout << "Promotions: " << detailed_perft_results.promotions << std::endl;
-    std::cout << "Double pushes: " << detailed_perft_results.double_pushes << std::endl;
-    std::cout << "Checks: " << detailed_perft_results.checks << std::endl;
-    std::cout << "Checkmates (from previous position): " << detailed_perft_results.checkmates << std::endl << std::endl;
+    uint64_t total = 0;
+    for (const DepthResult& depth : depths)
+    {
+      total += depth.result.nodes;
+    }
+    return total;
+  }
+
+  double seconds() const
+  {
+    double total = 0;
+    for (const DepthResult& depth : depths)
+    {
+      total += depth.seconds;
+    }
+    return total;
   }
-  else
+
+  bool passed() const
   {
-    std::cout << std::endl << "No valid moves generated." << std::endl << std::endl;
+    return std::all_of(depths.begin(), depths.end(), [](const DepthResult& depth) { return depth.passed(); });
   }
+};
+
+uint64_t nodes_per_second(uint64_t nodes, double seconds)
+{
+  return seconds > 0 ? static_cast<uint64_t>(nodes / seconds) : 0;
 }
 
-uint64_t perft(Position position, int depth, DetailedPerftResults* detailed_perft_results)
+std::string json_string(const std::string& text)
 {
-  if (depth == 0)
+  std::string quoted = "\"";
+  for (char c : text)
   {
-    return 1ull;
+    if (c == '"' || c == '\\')
+    {
+      quoted += '\\';
+    }
+    quoted += c;
   }
+  return quoted + "\"";
+}
 
-  Position new_position;
-  std::vector<uint32_t> moves;
-  int moves_from_iteration;
-  uint64_t nodes = 0;
+// The whole of text as a number, throwing like std::stoi when any of it is not part of the number
+int parse_number(const std::string& text)
+{
+  size_t pos = 0;
+  int value = std::stoi(text, &pos);
+  if (pos != text.size())
+  {
+    throw std::invalid_argument(text);
+  }
+  return value;
+}
 
-  moves = valid_moves_for_position(position);
+// Returns false when the arguments cannot be used, after saying why. help is set when usage was asked for.
+bool parse_options(int argc, char* argv[], Options* options, bool* help)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
 
-  if (moves.size() == 0)
+    try
+    {
+      if (arg == "--help" || arg == "-h")
+      {
+        *help = true;
+        return true;
+      }
+      else if (arg == "--fen" && has_value)
+      {
+        options->fen = argv[++i];
+      }
+      else if (arg == "--depth" && has_value)
+      {
+        options->depth = parse_number(argv[++i]);
+        options->depth_given = true;
+        if (options->depth < 1)
+        {
+          std::cerr << "--depth must be at least 1" << std::endl << usage;
+          return false;
+        }
+      }
+      else if (arg == "--divide")
+      {
+        options->divide = true;
+      }
+      else if (arg == "--stats")
+      {
+        options->stats = true;
+      }
+      else if (arg == "--threads" && has_value)
+      {
+        options->threads = parse_number(argv[++i]);
+        if (options->threads < 1)
+        {
+          std::cerr << "--threads must be at least 1" << std::endl << usage;
+          return false;
+        }
+      }
+      else if (arg == "--hash" && has_value)
+      {
+        int hash_mb = parse_number(argv[++i]);
+        if (hash_mb < 0)
+        {
+          std::cerr << "--hash must not be negative" << std::endl << usage;
+          return false;
+        }
+        options->hash_mb = static_cast<size_t>(hash_mb);
+      }
+      else if (arg == "--epd" && has_value)
+      {
+        options->epd_path = argv[++i];
+      }
+      else if (arg == "--json")
+      {
+        options->json = true;
+      }
+      else
+      {
+        std::cerr << "Unknown or incomplete option: " << arg << std::endl << usage;
+        return false;
+      }
+    }
+    catch (const std::exception&)
+    {
+      std::cerr << "Expected a number after " << arg << std::endl << usage;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// The suite lines to run, a single unchecked entry when no suite is given
+bool load_suite(const Options& options, std::vector<perft::SuiteEntry>* suite)
+{
+  if (options.epd_path.empty())
   {
-    detailed_perft_results->checkmates++;
+    try
+    {
+      // Through the suite parser so a FEN without move counters is accepted here too
+      suite->push_back({perft::parse_epd_line(options.fen).fen, {{options.depth, 0}}});
+      return true;
+    }
+    catch (const std::exception& error)
+    {
+      std::cerr << error.what() << std::endl;
+      return false;
+    }
   }
 
-  for (uint32_t move : moves)
+  std::ifstream file(options.epd_path);
+  if (!file)
   {
-    new_position = make_move(&position, move);
+    std::cerr << "Unable to open " << options.epd_path << std::endl;
+    return false;
+  }
+
+  std::string line;
+  for (int line_number = 1; std::getline(file, line); line_number++)
+  {
+    if (line.find_first_not_of(" \t\r") == std::string::npos || line[0] == '#')
+    {
+      continue;
+    }
 
-    // detailed_perft_results->captures += decode_capture(move);
-    // detailed_perft_results->enpassants += decode_enpassant(move);
-    // detailed_perft_results->castles += decode_castling(move);
-    // detailed_perft_results->promotions += decode_promoted_to_piece(move) == NO_PIECE ? 0 : 1;
-    // detailed_perft_results->double_pushes += decode_double_push(move);
-    // detailed_perft_results->checks += decode_check(move);
+    try
+    {
+      suite->push_back(perft::parse_epd_line(line));
+    }
+    catch (const std::exception& error)
+    {
+      std::cerr << options.epd_path << ":" << line_number << ": " << error.what() << std::endl;
+      return false;
+    }
+  }
 
-    uint64_t nodes_for_move = perft(new_position, depth - 1, detailed_perft_results);
+  return true;
+}
 
-    if (depth == PERFT_DEPTH)
+PositionResult run_position(const perft::SuiteEntry& entry, const Options& options)
+{
+  PositionResult result{entry.fen, {}};
+  Position position = Util::Initializers::fen_string_to_position(entry.fen);
+  bool checked = !options.epd_path.empty();
+
+  for (const auto& [depth, expected] : entry.expected)
+  {
+    if (checked && options.depth_given && depth > options.depth)
+    {
+      continue;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    perft::PerftResult counts = perft::run(&position, depth, options.threads, options.hash_mb, options.stats);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    result.depths.push_back({depth, checked, expected, counts, elapsed.count()});
+  }
+
+  return result;
+}
+
+void print_text(const PositionResult& result, const Options& options)
+{
+  std::cout << result.fen << std::endl;
+
+  for (const DepthResult& depth : result.depths)
+  {
+    std::cout << "  depth " << std::setw(2) << depth.depth << std::setw(14) << depth.result.nodes << " nodes "
+              << std::fixed << std::setprecision(3) << std::setw(9) << depth.seconds << " s "
+              << std::setw(12) << nodes_per_second(depth.result.nodes, depth.seconds) << " nps";
+    if (depth.checked)
     {
-      std::cout << square_names[decode_from_square(move)] << square_names[decode_to_square(move)] << ": "
-                << nodes_for_move << std::endl;
+      std::cout << (depth.passed() ? "  pass" : "  FAIL, expected " + std::to_string(depth.expected));
     }
+    std::cout << std::endl;
+
+    if (options.stats)
+    {
+      const perft::PerftStats& stats = depth.result.stats;
+      std::cout << "    captures " << stats.captures << ", en passant " << stats.en_passants << ", castles "
+                << stats.castles << ", promotions " << stats.promotions << ", double pushes " << stats.double_pushes
+                << ", checks " << stats.checks << ", checkmates " << stats.checkmates << std::endl;
+    }
+
+    if (options.divide)
+    {
+      for (const perft::DivideEntry& entry : depth.result.divide)
+      {
+        std::cout << "    " << uint_move_to_engine_string_move(entry.move) << ": " << entry.nodes << std::endl;
+      }
+    }
+  }
+
+  std::cout << "  " << (result.passed() ? "PASS" : "FAIL") << " " << result.nodes() << " nodes in " << std::fixed
+            << std::setprecision(3) << result.seconds() << " s, "
+            << nodes_per_second(result.nodes(), result.seconds()) << " nps" << std::endl
+            << std::endl;
+}
+
+void print_json(const std::vector<PositionResult>& results, const Options& options)
+{
+  uint64_t total_nodes = 0;
+  double total_seconds = 0;
+  bool all_passed = true;
 
-    nodes += nodes_for_move;
+  std::ostringstream positions;
+  positions << std::setprecision(6) << std::fixed;
+  for (size_t i = 0; i < results.size(); i++)
+  {
+    const PositionResult& result = results[i];
+    total_nodes += result.nodes();
+    total_seconds += result.seconds();
+    all_passed = all_passed && result.passed();
+
+    positions << (i ? ",\n" : "") << "    {\"fen\": " << json_string(result.fen) << ", \"pass\": "
+              << (result.passed() ? "true" : "false") << ", \"nodes\": " << result.nodes()
+              << ", \"seconds\": " << result.seconds()
+              << ", \"nps\": " << nodes_per_second(result.nodes(), result.seconds()) << ", \"depths\": [";
+
+    for (size_t j = 0; j < result.depths.size(); j++)
+    {
+      const DepthResult& depth = result.depths[j];
+      positions << (j ? ", " : "") << "{\"depth\": " << depth.depth << ", \"nodes\": " << depth.result.nodes;
+      if (depth.checked)
+      {
+        positions << ", \"expected\": " << depth.expected << ", \"pass\": " << (depth.passed() ? "true" : "false");
+      }
+      positions << ", \"seconds\": " << depth.seconds;
+
+      if (options.stats)
+      {
+        const perft::PerftStats& stats = depth.result.stats;
+        positions << ", \"stats\": {\"captures\": " << stats.captures << ", \"en_passants\": " << stats.en_passants
+                  << ", \"castles\": " << stats.castles << ", \"promotions\": " << stats.promotions
+                  << ", \"double_pushes\": " << stats.double_pushes << ", \"checks\": " << stats.checks
+                  << ", \"checkmates\": " << stats.checkmates << "}";
+      }
+
+      if (options.divide)
+      {
+        positions << ", \"divide\": {";
+        for (size_t k = 0; k < depth.result.divide.size(); k++)
+        {
+          const perft::DivideEntry& entry = depth.result.divide[k];
+          positions << (k ? ", " : "") << json_string(uint_move_to_engine_string_move(entry.move)) << ": "
+                    << entry.nodes;
+        }
+        positions << "}";
+      }
+      positions << "}";
+    }
+    positions << "]}";
   }
 
-  return nodes;
+  std::cout << std::setprecision(6) << std::fixed << "{\n"
+            << "  \"threads\": " << options.threads << ",\n"
+            << "  \"hash_mb\": " << options.hash_mb << ",\n"
+            << "  \"pass\": " << (all_passed ? "true" : "false") << ",\n"
+            << "  \"nodes\": " << total_nodes << ",\n"
+            << "  \"seconds\": " << total_seconds << ",\n"
+            << "  \"nps\": " << nodes_per_second(total_nodes, total_seconds) << ",\n"
+            << "  \"positions\": [\n"
+            << positions.str() << "\n  ]\n"
+            << "}" << std::endl;
 }
 
 int main(int argc, char* argv[])
 {
-  Position position = Util::Initializers::starting_position();
-  // std::string fen = "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10";
-  // std::string fen = "rnbqkbnr/p1ppppp1/7p/Pp6/8/8/1PPPPPPP/RNBQKBNR w KQkq b6 0 1";
-  // Position position = Util::Initializers::fen_string_to_position(fen);
+  // Perft hashing keys on the position's Zobrist hash
+  zobrist::init();
 
-  int move_count = 0;
+  Options options;
+  bool help = false;
+  if (!parse_options(argc, argv, &options, &help))
+  {
+    return 2;
+  }
+  if (help)
+  {
+    std::cout << usage;
+    return 0;
+  }
 
-  Util::cli_display_position(&position);
+  std::vector<perft::SuiteEntry> suite;
+  if (!load_suite(options, &suite))
+  {
+    return 2;
+  }
 
-  DetailedPerftResults detailed_perft_results;
+  if (!options.json && options.epd_path.empty())
+  {
+    Position position = Util::Initializers::fen_string_to_position(options.fen);
+    Util::cli_display_position(&position);
+  }
+
+  std::vector<PositionResult> results;
+  int passed = 0;
+  for (const perft::SuiteEntry& entry : suite)
+  {
+    results.push_back(run_position(entry, options));
+    passed += results.back().passed();
 
-  auto start = std::chrono::high_resolution_clock::now();
-  uint64_t found_nodes = perft(position, PERFT_DEPTH, &detailed_perft_results);
-  auto stop = std::chrono::high_resolution_clock::now();
-  auto duration = duration_cast<std::chrono::nanoseconds>(stop - start);
+    if (!options.json)
+    {
+      print_text(results.back(), options);
+    }
+  }
 
-  DOUBLE_SPACE;
+  if (options.json)
+  {
+    print_json(results, options);
+  }
+  else if (!options.epd_path.empty())
+  {
+    std::cout << passed << "/" << results.size() << " positions passed on " << options.threads << " threads"
+              << std::endl;
+  }
 
-  display_perft_results(duration, PERFT_DEPTH, found_nodes, detailed_perft_results);
-}
\ No newline at end of file
+  return passed == static_cast<int>(results.size()) ? 0 : 1;
+}
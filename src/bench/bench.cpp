@@ -0,0 +1,223 @@
+#include "bench.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../game/moves.hpp"
+#include "../search/search.hpp"
+#include "../search/transposition.hpp"
+#include "../util/initializers.hpp"
+
+namespace bench
+{
+
+// Opening, middlegame and endgame positions (the standard perft suite plus the start position)
+static const std::array<std::string, 6> bench_positions = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+};
+
+void run(int movetime_ms)
+{
+  std::cout << "Slider attacks  : " << (slider_backend == PEXT ? "PEXT" : "magic") << std::endl;
+
+  uint64_t total_nodes = 0;
+  uint64_t total_moves_scored = 0;
+  int64_t total_ms = 0;
+  int64_t total_first_info_us = 0;
+  int64_t max_first_info_us = 0;
+
+  for (const std::string& fen : bench_positions)
+  {
+    // Every position starts from a cold TT and cold worker tables so runs are comparable
+    TT.clear();
+    search_context.clear();
+    clear_search_tables();
+
+    Position position = Util::Initializers::fen_string_to_position(fen);
+    set_search_time_limit(movetime_ms);
+
+    std::cout << "\nPosition: " << fen << std::endl;
+    find_move_return_val result = find_move(&position);
+
+    total_nodes += result.nodes;
+    total_moves_scored += result.moves_scored;
+    total_ms += result.miliseconds_of_search_time.count();
+    total_first_info_us += result.first_info_latency.count();
+    max_first_info_us = std::max<int64_t>(max_first_info_us, result.first_info_latency.count());
+  }
+
+  std::cout << "\n===========================" << std::endl;
+  std::cout << "Total time (ms) : " << total_ms << std::endl;
+  std::cout << "Nodes searched  : " << total_nodes << std::endl;
+  std::cout << "Nodes/second    : " << total_nodes * 1000 / (total_ms + 1) << std::endl;
+  std::cout << "Moves scored    : " << total_moves_scored << std::endl;
+  std::cout << "Scores/node     : " << static_cast<double>(total_moves_scored) / std::max<uint64_t>(total_nodes, 1)
+            << std::endl;
+  std::cout << "Go to info (us) : " << total_first_info_us / static_cast<int64_t>(bench_positions.size())
+            << " average, " << max_first_info_us << " max, on " << get_thread_count() << " threads" << std::endl;
+}
+
+// Kept so the bench can time the bitboard scan the board array replaced
+static PieceAsInt piece_from_bitboards(Position* position, int square)
+{
+  uint64_t target_bitboard = int_location_to_bitboard(square);
+  if (position->pawns & target_bitboard)
+    return PAWN;
+  else if (position->knights & target_bitboard)
+    return KNIGHT;
+  else if (position->bishops & target_bitboard)
+    return BISHOP;
+  else if (position->rooks & target_bitboard)
+    return ROOK;
+  else if (position->queens & target_bitboard)
+    return QUEEN;
+  else if (position->kings & target_bitboard)
+    return KING;
+  return NO_PIECE;
+}
+
+// As many bytes as Position without the board array, copied to measure what the extra bytes cost
+struct BitboardsOnlyPosition
+{
+  std::array<uint8_t, sizeof(Position) - sizeof(Position::board)> bytes;
+};
+
+// Stops the compiler from dropping the timed loops
+static volatile uint64_t bench_sink;
+
+template <typename Work>
+static double nanoseconds_per_operation(uint64_t operations, Work&& work)
+{
+  auto start = std::chrono::steady_clock::now();
+  work();
+  auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+  return static_cast<double>(elapsed.count()) / std::max<uint64_t>(operations, 1);
+}
+
+void run_board(int iterations)
+{
+  // The bench positions and every position one move from them
+  std::vector<Position> positions;
+  std::vector<std::pair<Position, uint32_t>> position_moves;
+  for (const std::string& fen : bench_positions)
+  {
+    Position root = Util::Initializers::fen_string_to_position(fen);
+    positions.push_back(root);
+    for (uint32_t move : generate_moves(&root, ALL_LEGAL))
+    {
+      position_moves.push_back({root, move});
+      positions.push_back(make_move(&root, move));
+    }
+  }
+
+  std::vector<int> occupied_squares;
+  std::vector<Position*> occupied_positions;
+  for (Position& position : positions)
+  {
+    for (uint64_t occupied = all_occupied(&position); occupied; occupied &= occupied - 1)
+    {
+      occupied_positions.push_back(&position);
+      occupied_squares.push_back(bitscan(occupied));
+    }
+  }
+
+  uint64_t copies = static_cast<uint64_t>(iterations) * positions.size();
+  uint64_t makes = static_cast<uint64_t>(iterations) * position_moves.size();
+  uint64_t lookups = static_cast<uint64_t>(iterations) * occupied_squares.size();
+  std::vector<Position> position_copies(positions.size());
+  std::vector<BitboardsOnlyPosition> bitboard_copies(positions.size());
+
+  double copy_ns = nanoseconds_per_operation(copies, [&]() {
+    for (int i = 0; i < iterations; i++)
+    {
+      for (size_t j = 0; j < positions.size(); j++)
+      {
+        position_copies[j] = positions[j];
+      }
+      bench_sink = bench_sink + position_copies[i % positions.size()].hash;
+    }
+  });
+  double bitboard_copy_ns = nanoseconds_per_operation(copies, [&]() {
+    for (int i = 0; i < iterations; i++)
+    {
+      for (size_t j = 0; j < positions.size(); j++)
+      {
+        std::copy_n(reinterpret_cast<const uint8_t*>(&positions[j]), sizeof(BitboardsOnlyPosition),
+                    bitboard_copies[j].bytes.data());
+      }
+      bench_sink = bench_sink + bitboard_copies[i % positions.size()].bytes[0];
+    }
+  });
+  double make_move_ns = nanoseconds_per_operation(makes, [&]() {
+    for (int i = 0; i < iterations; i++)
+    {
+      for (auto& [position, move] : position_moves)
+      {
+        bench_sink = bench_sink + make_move(&position, move).hash;
+      }
+    }
+  });
+  double board_lookup_ns = nanoseconds_per_operation(lookups, [&]() {
+    for (int i = 0; i < iterations; i++)
+    {
+      uint64_t sum = 0;
+      for (size_t j = 0; j < occupied_squares.size(); j++)
+      {
+        sum += piece_on(occupied_positions[j], occupied_squares[j]);
+      }
+      bench_sink = bench_sink + sum;
+    }
+  });
+  double bitboard_lookup_ns = nanoseconds_per_operation(lookups, [&]() {
+    for (int i = 0; i < iterations; i++)
+    {
+      uint64_t sum = 0;
+      for (size_t j = 0; j < occupied_squares.size(); j++)
+      {
+        sum += piece_from_bitboards(occupied_positions[j], occupied_squares[j]);
+      }
+      bench_sink = bench_sink + sum;
+    }
+  });
+  // Rook and bishop attacks from every occupied square, through each backend
+  auto slider_lookup_ns = [&](auto bishop_lookup, auto rook_lookup) {
+    return nanoseconds_per_operation(lookups, [&]() {
+      for (int i = 0; i < iterations; i++)
+      {
+        uint64_t sum = 0;
+        for (size_t j = 0; j < occupied_squares.size(); j++)
+        {
+          uint64_t occupancy = all_occupied(occupied_positions[j]);
+          sum += bishop_lookup(occupancy, occupied_squares[j]) ^ rook_lookup(occupancy, occupied_squares[j]);
+        }
+        bench_sink = bench_sink + sum;
+      }
+    });
+  };
+  double magic_lookup_ns = slider_lookup_ns(bishop_attacks_magic, rook_attacks_magic);
+  double pext_lookup_ns = slider_lookup_ns(bishop_attacks_pext, rook_attacks_pext);
+
+  std::cout << "Position size (bytes)        : " << sizeof(Position) << " (" << sizeof(BitboardsOnlyPosition)
+            << " without the board)" << std::endl;
+  std::cout << "Position copy (ns)           : " << copy_ns << std::endl;
+  std::cout << "Copy without board (ns)      : " << bitboard_copy_ns << std::endl;
+  std::cout << "make_move (ns)               : " << make_move_ns << std::endl;
+  std::cout << "Piece lookup, board (ns)     : " << board_lookup_ns << std::endl;
+  std::cout << "Piece lookup, bitboards (ns) : " << bitboard_lookup_ns << std::endl;
+  std::cout << "Slider attacks, magic (ns)   : " << magic_lookup_ns << std::endl;
+  if (pext_supported())
+  {
+    std::cout << "Slider attacks, PEXT (ns)    : " << pext_lookup_ns << std::endl;
+  }
+}
+
+}  // namespace bench
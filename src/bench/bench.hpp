@@ -0,0 +1,23 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+namespace bench
+{
+
+// Default search time per bench position (ms)
+constexpr int DEFAULT_BENCH_MOVETIME_MS = 1000;
+
+// Search a fixed set of positions and report total nodes, nodes per second and how long each search took to print its
+// first info line
+void run(int movetime_ms = DEFAULT_BENCH_MOVETIME_MS);
+
+// Default passes over the positions for the board representation bench
+constexpr int DEFAULT_BOARD_BENCH_ITERATIONS = 20000;
+
+// Time copying a Position, make_move, piece lookups through the board array against the bitboard scan, and slider
+// attack lookups through each backend
+void run_board(int iterations = DEFAULT_BOARD_BENCH_ITERATIONS);
+
+}  // namespace bench
+
+#endif
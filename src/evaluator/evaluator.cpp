@@ -99,89 +99,55 @@ static int tapered_eval(int mg_score, int eg_score, int phase)
   return (mg_score * phase + eg_score * (TOTAL_PHASE - phase)) / TOTAL_PHASE;
 }
 
-// Count attacks near a king
-static int count_king_attackers(Position* position, int king_sq, bool attacking_white)
+// Count attacks near a king, a piece type missing from the attacker's maps around the king is skipped
+static int count_king_attackers(Position* position, int king_sq, bool attacking_white, const AttackMaps& attacker_maps)
 {
   int attacks = 0;
   uint64_t king_zone = king_moves[king_sq];
   uint64_t occupancy = all_occupied(position);
+  uint64_t attackers = attacking_white ? position->white : position->black;
 
-  if (attacking_white)
+  if (attacker_maps.by_piece[KNIGHT] & king_zone)
   {
-    // White pieces attacking black king zone
-    uint64_t knights = white_knights(position);
+    uint64_t knights = attackers & position->knights;
     while (knights)
     {
-      int sq = bitscan(knights);
+      int sq = pop_lsb(knights);
       if (knight_moves[sq] & king_zone)
         attacks++;
-      knights &= knights - 1;
-    }
-
-    uint64_t bishops = white_bishops(position);
-    while (bishops)
-    {
-      int sq = bitscan(bishops);
-      if (bishop_attacks(occupancy, sq) & king_zone)
-        attacks++;
-      bishops &= bishops - 1;
-    }
-
-    uint64_t rooks = white_rooks(position);
-    while (rooks)
-    {
-      int sq = bitscan(rooks);
-      if (rook_attacks(occupancy, sq) & king_zone)
-        attacks++;
-      rooks &= rooks - 1;
-    }
-
-    uint64_t queens = white_queens(position);
-    while (queens)
-    {
-      int sq = bitscan(queens);
-      if (queen_attacks(occupancy, sq) & king_zone)
-        attacks += 2;
-      queens &= queens - 1;
     }
   }
-  else
-  {
-    // Black pieces attacking white king zone
-    uint64_t knights = black_knights(position);
-    while (knights)
-    {
-      int sq = bitscan(knights);
-      if (knight_moves[sq] & king_zone)
-        attacks++;
-      knights &= knights - 1;
-    }
 
-    uint64_t bishops = black_bishops(position);
+  if (attacker_maps.by_piece[BISHOP] & king_zone)
+  {
+    uint64_t bishops = attackers & position->bishops;
     while (bishops)
     {
-      int sq = bitscan(bishops);
+      int sq = pop_lsb(bishops);
       if (bishop_attacks(occupancy, sq) & king_zone)
         attacks++;
-      bishops &= bishops - 1;
     }
+  }
 
-    uint64_t rooks = black_rooks(position);
+  if (attacker_maps.by_piece[ROOK] & king_zone)
+  {
+    uint64_t rooks = attackers & position->rooks;
     while (rooks)
     {
-      int sq = bitscan(rooks);
+      int sq = pop_lsb(rooks);
       if (rook_attacks(occupancy, sq) & king_zone)
         attacks++;
-      rooks &= rooks - 1;
     }
+  }
 
-    uint64_t queens = black_queens(position);
+  if (attacker_maps.by_piece[QUEEN] & king_zone)
+  {
+    uint64_t queens = attackers & position->queens;
     while (queens)
     {
-      int sq = bitscan(queens);
+      int sq = pop_lsb(queens);
       if (queen_attacks(occupancy, sq) & king_zone)
         attacks += 2;
-      queens &= queens - 1;
     }
   }
 
@@ -197,7 +163,7 @@ static int evaluate_pawns_for_side(uint64_t my_pawns, uint64_t their_pawns, bool
 
   while (pawns)
   {
-    int sq = bitscan(pawns);
+    int sq = pop_lsb(pawns);
     int file = file_of(sq);
     int rank = rank_of(sq);
 
@@ -268,8 +234,6 @@ static int evaluate_pawns_for_side(uint64_t my_pawns, uint64_t their_pawns, bool
         eg_score += PASSED_PAWN_BONUS_BASE + advancement * 10;
       }
     }
-
-    pawns &= pawns - 1;
   }
 
   return mg_score;  // Simplified - full tapered would track both
@@ -288,7 +252,7 @@ static void evaluate_pieces(Position* position, bool white, int& mg_score, int&
   uint64_t knights = white ? white_knights(position) : black_knights(position);
   while (knights)
   {
-    int sq = bitscan(knights);
+    int sq = pop_lsb(knights);
     mg_score += KNIGHT_MG + knight_pst[sq];
     eg_score += KNIGHT_EG + knight_pst[sq];
 
@@ -310,8 +274,6 @@ static void evaluate_pieces(Position* position, bool white, int& mg_score, int&
       if (pawn_defenders)
         mg_score += KNIGHT_OUTPOST;
     }
-
-    knights &= knights - 1;
   }
 
   // Bishops
@@ -325,22 +287,20 @@ static void evaluate_pieces(Position* position, bool white, int& mg_score, int&
 
   while (bishops)
   {
-    int sq = bitscan(bishops);
+    int sq = pop_lsb(bishops);
     mg_score += BISHOP_MG + (white ? white_bishop_pst[sq] : black_bishop_pst[sq]);
     eg_score += BISHOP_EG + (white ? white_bishop_pst[sq] : black_bishop_pst[sq]);
 
     // Mobility
     uint64_t attacks = bishop_attacks(occupancy, sq) & ~my_pieces;
     mobility += bitcount(attacks) * BISHOP_MOBILITY;
-
-    bishops &= bishops - 1;
   }
 
   // Rooks
   uint64_t rooks = white ? white_rooks(position) : black_rooks(position);
   while (rooks)
   {
-    int sq = bitscan(rooks);
+    int sq = pop_lsb(rooks);
     mg_score += ROOK_MG + rook_pst[sq];
     eg_score += ROOK_EG + rook_pst[sq];
 
@@ -368,23 +328,19 @@ static void evaluate_pieces(Position* position, bool white, int& mg_score, int&
       mg_score += ROOK_ON_7TH;
       eg_score += ROOK_ON_7TH;
     }
-
-    rooks &= rooks - 1;
   }
 
   // Queens
   uint64_t queens = white ? white_queens(position) : black_queens(position);
   while (queens)
   {
-    int sq = bitscan(queens);
+    int sq = pop_lsb(queens);
     mg_score += QUEEN_MG + queen_pst[sq];
     eg_score += QUEEN_EG + queen_pst[sq];
 
     // Mobility (limited weight for queen)
     uint64_t attacks = queen_attacks(occupancy, sq) & ~my_pieces;
     mobility += bitcount(attacks) * QUEEN_MOBILITY;
-
-    queens &= queens - 1;
   }
 
   // King
@@ -426,8 +382,8 @@ int_fast32_t evaluate_position(Position* position)
   int white_king_sq = bitscan(white_kings(position));
   int black_king_sq = bitscan(black_kings(position));
 
-  int attacks_on_white_king = count_king_attackers(position, white_king_sq, false);
-  int attacks_on_black_king = count_king_attackers(position, black_king_sq, true);
+  int attacks_on_white_king = count_king_attackers(position, white_king_sq, false, attack_maps(false, position));
+  int attacks_on_black_king = count_king_attackers(position, black_king_sq, true, attack_maps(true, position));
 
   white_mg -= attacks_on_white_king * attacks_on_white_king * KING_ATTACK_WEIGHT;
   black_mg -= attacks_on_black_king * attacks_on_black_king * KING_ATTACK_WEIGHT;
@@ -55,7 +55,7 @@ bool Manager::is_draw() const { return is_draw_by_fifty_moves() || is_repetition
 
 void Manager::update_to_position(std::vector<std::string> tokens)
 {
-  std::vector<uint32_t> possible_moves;
+  MoveList possible_moves;
   int from_square, to_square, move_to_square, move_from_square;
   PieceAsInt promotion_peice, move_promotion_piece;
 
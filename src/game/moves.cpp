@@ -2,338 +2,323 @@
 
 #include <algorithm>
 
+#include "../util/constants.hpp"
 #include "../util/zobrist.hpp"
 
-PieceAsInt victim_on_square(Position* position, Square square)
+template <typename Generator>
+constexpr auto square_pair_table_generator(Generator&& f)
 {
-  uint64_t target_bitboard = int_location_to_bitboard(square);
-  if (position->pawns & target_bitboard)
+  std::array<std::array<uint64_t, 64>, 64> table{};
+
+  for (int from = 0; from < 64; from++)
   {
-    return PAWN;
+    for (int to = 0; to < 64; to++)
+    {
+      table[from][to] = f(from, to);
+    }
   }
-  else if (position->knights & target_bitboard)
+
+  return table;
+}
+
+// Squares strictly between two squares sharing a rank, file or diagonal (empty otherwise)
+constexpr uint64_t squares_between(int from, int to)
+{
+  uint64_t from_bitboard = 1ull << from;
+  uint64_t to_bitboard = 1ull << to;
+
+  if (from == to)
   {
-    return KNIGHT;
+    return 0;
   }
-  else if (position->bishops & target_bitboard)
+  if (rook_attack_mask_for_bitboard(from_bitboard, 0) & to_bitboard)
   {
-    return BISHOP;
+    return rook_attack_mask_for_bitboard(from_bitboard, to_bitboard) &
+           rook_attack_mask_for_bitboard(to_bitboard, from_bitboard);
   }
-  else if (position->rooks & target_bitboard)
+  if (bishop_attack_mask_for_bitboard(from_bitboard, 0) & to_bitboard)
   {
-    return ROOK;
+    return bishop_attack_mask_for_bitboard(from_bitboard, to_bitboard) &
+           bishop_attack_mask_for_bitboard(to_bitboard, from_bitboard);
   }
-  else if (position->queens & target_bitboard)
+
+  return 0;
+}
+
+// The whole rank, file or diagonal running through two squares (empty if they are not aligned)
+constexpr uint64_t line_through_squares(int from, int to)
+{
+  uint64_t from_bitboard = 1ull << from;
+  uint64_t to_bitboard = 1ull << to;
+
+  if (from == to)
   {
-    return QUEEN;
+    return 0;
   }
-  else if (position->kings & target_bitboard)
+  if (rook_attack_mask_for_bitboard(from_bitboard, 0) & to_bitboard)
   {
-    return KING;
+    return (rook_attack_mask_for_bitboard(from_bitboard, 0) & rook_attack_mask_for_bitboard(to_bitboard, 0)) |
+           from_bitboard | to_bitboard;
   }
-  else
+  if (bishop_attack_mask_for_bitboard(from_bitboard, 0) & to_bitboard)
   {
-    // we are attacking an enpassant square
-    return PAWN;
+    return (bishop_attack_mask_for_bitboard(from_bitboard, 0) & bishop_attack_mask_for_bitboard(to_bitboard, 0)) |
+           from_bitboard | to_bitboard;
   }
+
+  return 0;
 }
 
-Position make_move(Position* position, uint32_t move)
+static constexpr auto between = square_pair_table_generator(squares_between);
+static constexpr auto line_through = square_pair_table_generator(line_through_squares);
+
+// Destinations a piece on `square` may move to without leaving its own king in check
+static inline uint64_t legal_destinations(int square, const LegalityMasks& masks)
 {
-  Position new_position = *position;
+  uint64_t destinations = masks.check_mask;
+  if (masks.pinned & int_location_to_bitboard(square))
+  {
+    destinations &= line_through[masks.king_square][square];
+  }
+  return destinations;
+}
+
+PieceAsInt victim_on_square(Position* position, Square square)
+{
+  PieceAsInt piece = piece_on(position, square);
+
+  // An empty target square is the en passant square
+  return piece == NO_PIECE ? PAWN : piece;
+}
+
+// The bitboard in Position holding every piece of one type
+static inline uint64_t& pieces_of_type(Position* position, PieceAsInt piece)
+{
+  switch (piece)
+  {
+    case KNIGHT:
+      return position->knights;
+    case BISHOP:
+      return position->bishops;
+    case ROOK:
+      return position->rooks;
+    case QUEEN:
+      return position->queens;
+    case PAWN:
+      return position->pawns;
+    default:
+      return position->kings;
+  }
+}
+
+template <Color Us>
+void do_move(Position* position, uint32_t move, StateInfo* state)
+{
+  constexpr Color Them = opposite(Us);
+  constexpr bool white = Us == WHITE;
+  // Squares of our castling rook and king, and the square behind a double-pushed pawn (toward its start)
+  constexpr int kingside_rook = white ? h1 : h8;
+  constexpr int queenside_rook = white ? a1 : a8;
+  constexpr int kingside_castle = white ? g1 : g8;
+  constexpr int behind = white ? 8 : -8;
 
   int from_sq = decode_from_square(move);
   int to_sq = decode_to_square(move);
   uint64_t from_square = int_location_to_bitboard(from_sq);
   uint64_t to_square = int_location_to_bitboard(to_sq);
-  bool double_push = decode_double_push(move);
-  bool castling = decode_castling(move);
   bool capture = decode_capture(move);
-  bool enpassant = decode_enpassant(move);
   PieceAsInt moved_piece = decode_moved_piece(move);
   PieceAsInt promotion_piece = decode_promoted_to_piece(move);
+  PieceAsInt placed_piece = promotion_piece != NO_PIECE ? promotion_piece : moved_piece;
 
-  // Color of moving side: 1 = white, 0 = black
-  int us = position->white_to_move ? 1 : 0;
-  int them = 1 - us;
+  uint64_t& our_pieces = white ? position->white : position->black;
+  uint64_t& their_pieces = white ? position->black : position->white;
+  bool& can_castle_kingside = white ? position->white_can_castle_kingside : position->black_can_castle_kingside;
+  bool& can_castle_queenside = white ? position->white_can_castle_queenside : position->black_can_castle_queenside;
 
-  // Start with current hash
-  uint64_t hash = position->hash;
+  state->hash = position->hash;
+  state->en_passant_target = position->enPassantTarget;
+  state->half_move_clock = position->half_move_clock;
+  state->castling_rights = zobrist::castling_rights_index(*position);
+  state->captured_piece = NO_PIECE;
 
-  // XOR out old castling rights
-  hash ^= zobrist::castling_keys[zobrist::castling_rights_index(*position)];
+  uint64_t hash = position->hash;
 
-  // XOR out old en passant file if any
+  // XOR out old castling rights and en passant file, flip side to move
+  hash ^= zobrist::castling_keys[state->castling_rights];
   if (position->enPassantTarget)
   {
-    int ep_file = file_of(bitscan(position->enPassantTarget));
-    hash ^= zobrist::ep_file_keys[ep_file];
+    hash ^= zobrist::ep_file_keys[file_of(bitscan(position->enPassantTarget))];
   }
-
-  // Flip side to move
   hash ^= zobrist::side_key;
 
-  // Update half-move clock (reset on pawn move or capture)
-  if (moved_piece == PAWN || capture)
-  {
-    new_position.half_move_clock = 0;
-  }
-  else
+  // Reset the half-move clock on pawn moves and captures, the full move clock counts black's moves
+  position->half_move_clock = (moved_piece == PAWN || capture) ? 0 : position->half_move_clock + 1;
+  if constexpr (!white)
   {
-    new_position.half_move_clock++;
+    position->full_move_clock++;
   }
 
-  // Increment full move clock after black's move
-  if (!position->white_to_move)
+  position->enPassantTarget = decode_double_push(move) ? int_location_to_bitboard(to_sq + behind) : 0ull;
+  position->white_to_move = !white;
+
+  if (capture)
   {
-    new_position.full_move_clock++;
+    int captured_sq = decode_enpassant(move) ? to_sq + behind : to_sq;
+    uint64_t captured_square = int_location_to_bitboard(captured_sq);
+    PieceAsInt captured_piece = piece_on(position, captured_sq);
+
+    hash ^= zobrist::piece_keys[Them][captured_piece][captured_sq];
+    pieces_of_type(position, captured_piece) ^= captured_square;
+    their_pieces ^= captured_square;
+    position->board[captured_sq] = NO_PIECE;
+    state->captured_piece = captured_piece;
+
+    // Capturing a rook on its starting square takes away that side's castling
+    if (to_sq == h1)
+      position->white_can_castle_kingside = false;
+    else if (to_sq == a1)
+      position->white_can_castle_queenside = false;
+    else if (to_sq == h8)
+      position->black_can_castle_kingside = false;
+    else if (to_sq == a8)
+      position->black_can_castle_queenside = false;
   }
 
-  new_position.enPassantTarget = 0ull;
-  new_position.white_to_move = !position->white_to_move;
+  hash ^= zobrist::piece_keys[Us][moved_piece][from_sq] ^ zobrist::piece_keys[Us][placed_piece][to_sq];
+  pieces_of_type(position, moved_piece) ^= from_square;
+  pieces_of_type(position, placed_piece) |= to_square;
+  our_pieces ^= from_square | to_square;
+  position->board[from_sq] = NO_PIECE;
+  position->board[to_sq] = placed_piece;
 
-  // Remove moving piece from source square (hash)
-  hash ^= zobrist::piece_keys[us][moved_piece][from_sq];
-
-  if (position->white_to_move)
+  if (moved_piece == KING)
   {
-    new_position.white ^= from_square | to_square;
-    new_position.black &= ~to_square;
-    if (double_push)
+    if (decode_castling(move))
     {
-      new_position.enPassantTarget |= to_square << 8;
+      // Kingside the rook goes from the h-file to the f-file, queenside from the a-file to the d-file
+      int rook_from = to_sq == kingside_castle ? kingside_rook : queenside_rook;
+      int rook_to = to_sq == kingside_castle ? to_sq - 1 : to_sq + 1;
+      uint64_t rook_squares = int_location_to_bitboard(rook_from) | int_location_to_bitboard(rook_to);
+
+      position->rooks ^= rook_squares;
+      our_pieces ^= rook_squares;
+      position->board[rook_from] = NO_PIECE;
+      position->board[rook_to] = ROOK;
+      hash ^= zobrist::piece_keys[Us][ROOK][rook_from] ^ zobrist::piece_keys[Us][ROOK][rook_to];
     }
+    can_castle_kingside = false;
+    can_castle_queenside = false;
   }
-  else
+  else if (moved_piece == ROOK)
   {
-    new_position.black ^= from_square | to_square;
-    new_position.white &= ~to_square;
-    if (double_push)
+    if (from_sq == kingside_rook)
+    {
+      can_castle_kingside = false;
+    }
+    else if (from_sq == queenside_rook)
     {
-      new_position.enPassantTarget |= to_square >> 8;
+      can_castle_queenside = false;
     }
   }
 
-  if (capture)
+  // XOR in new castling rights and en passant file
+  hash ^= zobrist::castling_keys[zobrist::castling_rights_index(*position)];
+  if (position->enPassantTarget)
   {
-    // Determine captured piece type for hash update
-    PieceAsInt captured_piece;
-    int captured_sq = to_sq;
+    hash ^= zobrist::ep_file_keys[file_of(bitscan(position->enPassantTarget))];
+  }
 
-    if (enpassant)
-    {
-      captured_piece = PAWN;
-      captured_sq = position->white_to_move ? to_sq + 8 : to_sq - 8;
-    }
-    else
-    {
-      // Determine captured piece from position bitboards
-      if (position->pawns & to_square)
-        captured_piece = PAWN;
-      else if (position->knights & to_square)
-        captured_piece = KNIGHT;
-      else if (position->bishops & to_square)
-        captured_piece = BISHOP;
-      else if (position->rooks & to_square)
-        captured_piece = ROOK;
-      else
-        captured_piece = QUEEN;
-    }
+  position->hash = hash;
+}
 
-    // XOR out captured piece from hash
-    hash ^= zobrist::piece_keys[them][captured_piece][captured_sq];
-
-    // Also revoke castling rights if capturing a rook on its starting square
-    if (to_square == int_location_to_bitboard(h1))
-      new_position.white_can_castle_kingside = false;
-    else if (to_square == int_location_to_bitboard(a1))
-      new_position.white_can_castle_queenside = false;
-    else if (to_square == int_location_to_bitboard(h8))
-      new_position.black_can_castle_kingside = false;
-    else if (to_square == int_location_to_bitboard(a8))
-      new_position.black_can_castle_queenside = false;
-
-    new_position.bishops &= ~to_square;
-    new_position.rooks &= ~to_square;
-    new_position.pawns &= ~to_square;
-    new_position.queens &= ~to_square;
-    new_position.knights &= ~to_square;
-
-    if (enpassant)
-    {
-      if (position->white_to_move)
-      {
-        new_position.pawns ^= to_square << 8;
-        new_position.black ^= to_square << 8;
-      }
-      else
-      {
-        new_position.pawns ^= to_square >> 8;
-        new_position.white ^= to_square >> 8;
-      }
-    }
-  }
+template <Color Us>
+void undo_move(Position* position, uint32_t move, const StateInfo& state)
+{
+  constexpr bool white = Us == WHITE;
+  constexpr int kingside_rook = white ? h1 : h8;
+  constexpr int queenside_rook = white ? a1 : a8;
+  constexpr int kingside_castle = white ? g1 : g8;
+  constexpr int behind = white ? 8 : -8;
 
-  switch (moved_piece)
-  {
-    case KNIGHT:
-      new_position.knights ^= from_square;
-      new_position.knights |= to_square;
-      hash ^= zobrist::piece_keys[us][KNIGHT][to_sq];
-      break;
-    case BISHOP:
-      new_position.bishops ^= from_square;
-      new_position.bishops |= to_square;
-      hash ^= zobrist::piece_keys[us][BISHOP][to_sq];
-      break;
-    case ROOK:
-      new_position.rooks ^= from_square;
-      new_position.rooks |= to_square;
-      hash ^= zobrist::piece_keys[us][ROOK][to_sq];
+  int from_sq = decode_from_square(move);
+  int to_sq = decode_to_square(move);
+  uint64_t from_square = int_location_to_bitboard(from_sq);
+  uint64_t to_square = int_location_to_bitboard(to_sq);
+  PieceAsInt moved_piece = decode_moved_piece(move);
+  PieceAsInt promotion_piece = decode_promoted_to_piece(move);
+  PieceAsInt placed_piece = promotion_piece != NO_PIECE ? promotion_piece : moved_piece;
 
-      if (position->white_to_move)
-      {
-        if (from_square == int_location_to_bitboard(h1))
-        {
-          new_position.white_can_castle_kingside = false;
-        }
-        else if (from_square == int_location_to_bitboard(a1))
-        {
-          new_position.white_can_castle_queenside = false;
-        }
-      }
-      else
-      {
-        if (from_square == int_location_to_bitboard(h8))
-        {
-          new_position.black_can_castle_kingside = false;
-        }
-        else if (from_square == int_location_to_bitboard(a8))
-        {
-          new_position.black_can_castle_queenside = false;
-        }
-      }
-      break;
-    case QUEEN:
-      new_position.queens ^= from_square;
-      new_position.queens |= to_square;
-      hash ^= zobrist::piece_keys[us][QUEEN][to_sq];
-      break;
-    case PAWN:
-      new_position.pawns ^= from_square;
+  uint64_t& our_pieces = white ? position->white : position->black;
+  uint64_t& their_pieces = white ? position->black : position->white;
 
-      if (promotion_piece != NO_PIECE)
-      {
-        // Add promoted piece to hash (not pawn)
-        hash ^= zobrist::piece_keys[us][promotion_piece][to_sq];
-        switch (promotion_piece)
-        {
-          case BISHOP:
-            new_position.bishops |= to_square;
-            break;
-          case KNIGHT:
-            new_position.knights |= to_square;
-            break;
-          case ROOK:
-            new_position.rooks |= to_square;
-            break;
-          case QUEEN:
-            new_position.queens |= to_square;
-            break;
-          default:
-            break;
-        }
-      }
-      else
-      {
-        new_position.pawns |= to_square;
-        hash ^= zobrist::piece_keys[us][PAWN][to_sq];
-      }
-      break;
-    case KING:
-      new_position.kings ^= from_square;
-      new_position.kings |= to_square;
-      hash ^= zobrist::piece_keys[us][KING][to_sq];
+  pieces_of_type(position, placed_piece) ^= to_square;
+  pieces_of_type(position, moved_piece) |= from_square;
+  our_pieces ^= from_square | to_square;
+  position->board[to_sq] = NO_PIECE;
+  position->board[from_sq] = moved_piece;
 
-      if (castling)
-      {
-        if (position->white_to_move)
-        {
-          if (to_square == int_location_to_bitboard(g1))
-          {
-            // Kingside castle - move rook from h1 to f1
-            new_position.rooks ^= int_location_to_bitboard(h1);
-            new_position.rooks |= int_location_to_bitboard(f1);
-            new_position.white ^= int_location_to_bitboard(h1);
-            new_position.white |= int_location_to_bitboard(f1);
-            hash ^= zobrist::piece_keys[1][ROOK][h1];
-            hash ^= zobrist::piece_keys[1][ROOK][f1];
-          }
-          else if (to_square == int_location_to_bitboard(c1))
-          {
-            // Queenside castle - move rook from a1 to d1
-            new_position.rooks ^= int_location_to_bitboard(a1);
-            new_position.rooks |= int_location_to_bitboard(d1);
-            new_position.white ^= int_location_to_bitboard(a1);
-            new_position.white |= int_location_to_bitboard(d1);
-            hash ^= zobrist::piece_keys[1][ROOK][a1];
-            hash ^= zobrist::piece_keys[1][ROOK][d1];
-          }
-        }
-        else
-        {
-          if (to_square == int_location_to_bitboard(g8))
-          {
-            // Kingside castle - move rook from h8 to f8
-            new_position.rooks ^= int_location_to_bitboard(h8);
-            new_position.rooks |= int_location_to_bitboard(f8);
-            new_position.black ^= int_location_to_bitboard(h8);
-            new_position.black |= int_location_to_bitboard(f8);
-            hash ^= zobrist::piece_keys[0][ROOK][h8];
-            hash ^= zobrist::piece_keys[0][ROOK][f8];
-          }
-          else if (to_square == int_location_to_bitboard(c8))
-          {
-            // Queenside castle - move rook from a8 to d8
-            new_position.rooks ^= int_location_to_bitboard(a8);
-            new_position.rooks |= int_location_to_bitboard(d8);
-            new_position.black ^= int_location_to_bitboard(a8);
-            new_position.black |= int_location_to_bitboard(d8);
-            hash ^= zobrist::piece_keys[0][ROOK][a8];
-            hash ^= zobrist::piece_keys[0][ROOK][d8];
-          }
-        }
-      }
-      if (position->white_to_move)
-      {
-        new_position.white_can_castle_queenside = false;
-        new_position.white_can_castle_kingside = false;
-      }
-      else
-      {
-        new_position.black_can_castle_kingside = false;
-        new_position.black_can_castle_queenside = false;
-      }
-      break;
-    default:
-      break;
+  if (decode_castling(move))
+  {
+    int rook_from = to_sq == kingside_castle ? kingside_rook : queenside_rook;
+    int rook_to = to_sq == kingside_castle ? to_sq - 1 : to_sq + 1;
+    uint64_t rook_squares = int_location_to_bitboard(rook_from) | int_location_to_bitboard(rook_to);
+
+    position->rooks ^= rook_squares;
+    our_pieces ^= rook_squares;
+    position->board[rook_to] = NO_PIECE;
+    position->board[rook_from] = ROOK;
   }
 
-  // XOR in new castling rights
-  hash ^= zobrist::castling_keys[zobrist::castling_rights_index(new_position)];
+  if (state.captured_piece != NO_PIECE)
+  {
+    int captured_sq = decode_enpassant(move) ? to_sq + behind : to_sq;
+    uint64_t captured_square = int_location_to_bitboard(captured_sq);
+
+    pieces_of_type(position, state.captured_piece) |= captured_square;
+    their_pieces |= captured_square;
+    position->board[captured_sq] = state.captured_piece;
+  }
 
-  // XOR in new en passant file if any
-  if (new_position.enPassantTarget)
+  position->white_can_castle_kingside = state.castling_rights & 1;
+  position->white_can_castle_queenside = state.castling_rights & 2;
+  position->black_can_castle_kingside = state.castling_rights & 4;
+  position->black_can_castle_queenside = state.castling_rights & 8;
+  position->enPassantTarget = state.en_passant_target;
+  position->half_move_clock = state.half_move_clock;
+  position->hash = state.hash;
+  position->white_to_move = white;
+  if constexpr (!white)
   {
-    int ep_file = file_of(bitscan(new_position.enPassantTarget));
-    hash ^= zobrist::ep_file_keys[ep_file];
+    position->full_move_clock--;
   }
+}
+
+void do_move(Position* position, uint32_t move, StateInfo* state)
+{
+  position->white_to_move ? do_move<WHITE>(position, move, state) : do_move<BLACK>(position, move, state);
+}
 
-  new_position.hash = hash;
+void undo_move(Position* position, uint32_t move, const StateInfo& state)
+{
+  // The side that made the move is the one not to move now
+  position->white_to_move ? undo_move<BLACK>(position, move, state) : undo_move<WHITE>(position, move, state);
+}
 
+template <Color Us>
+Position make_move(Position* position, uint32_t move)
+{
+  Position new_position = *position;
+  StateInfo state;
+  do_move<Us>(&new_position, move, &state);
   return new_position;
 }
 
+Position make_move(Position* position, uint32_t move)
+{
+  return position->white_to_move ? make_move<WHITE>(position, move) : make_move<BLACK>(position, move);
+}
+
 bool is_square_attacked(bool white, int square, Position* position)
 {
   return (white && (pawn_attacks[1][square] & black_pawns(position))) ||
@@ -346,16 +331,52 @@ bool is_square_attacked(bool white, int square, Position* position)
          (king_moves[square] & (white ? black_kings(position) : white_kings(position)));
 }
 
+uint64_t attackers_to(int square, uint64_t occupancy, Position* position)
+{
+  return (pawn_attacks[1][square] & black_pawns(position)) | (pawn_attacks[0][square] & white_pawns(position)) |
+         (knight_moves[square] & position->knights) | (king_moves[square] & position->kings) |
+         (bishop_attacks(occupancy, square) & (position->bishops | position->queens)) |
+         (rook_attacks(occupancy, square) & (position->rooks | position->queens));
+}
+
 uint64_t attacked_squares(bool white, Position* position)
 {
-  uint64_t attacked = 0;
-  for (int i = 63; i > -1; i--)
-  {
-    attacked <<= 1;
-    attacked |= is_square_attacked(white, i, position);
-  }
+  // The squares attacked by the opponent of white, as with is_square_attacked
+  return attack_maps(!white, position).all;
+}
 
-  return attacked;
+template <Color Us>
+AttackMaps attack_maps(Position* position, uint64_t occupancy)
+{
+  AttackMaps maps;
+  uint64_t our_pieces = pieces_of<Us>(position);
+  SliderAttackMaps sliders = slider_attacks_setwise(our_pieces & position->bishops, our_pieces & position->rooks,
+                                                    our_pieces & position->queens, occupancy);
+
+  maps.by_piece[PAWN] = pawn_attacks_for_bitboard(Us == WHITE, our_pieces & position->pawns);
+  maps.by_piece[KNIGHT] = knight_moves_for_bitboard(our_pieces & position->knights);
+  maps.by_piece[BISHOP] = sliders.bishops;
+  maps.by_piece[ROOK] = sliders.rooks;
+  maps.by_piece[QUEEN] = sliders.queens;
+  maps.by_piece[KING] = king_moves_for_bitboard(our_pieces & position->kings);
+  maps.all = maps.by_piece[PAWN] | maps.by_piece[KNIGHT] | maps.by_piece[BISHOP] | maps.by_piece[ROOK] |
+             maps.by_piece[QUEEN] | maps.by_piece[KING];
+
+  return maps;
+}
+
+AttackMaps attack_maps(bool white, Position* position)
+{
+  return white ? attack_maps<WHITE>(position, all_occupied(position))
+               : attack_maps<BLACK>(position, all_occupied(position));
+}
+
+// Squares our king may not stand on. Sliders see through the king so it cannot step back along the line of a check.
+template <Color Us>
+uint64_t king_danger(Position* position)
+{
+  uint64_t our_king = pieces_of<Us>(position) & position->kings;
+  return attack_maps<opposite(Us)>(position, all_occupied(position) & ~our_king).all;
 }
 
 uint32_t encode_move(int from_square, int to_square, bool whites_turn, int moved_peice, int promoted_to_piece,
@@ -368,30 +389,55 @@ uint32_t encode_move(int from_square, int to_square, bool whites_turn, int moved
          (static_cast<uint32_t>(from_square));
 }
 
-std::vector<uint32_t> pseudolegal_possible_moves(Position* position)
+template <Color Us>
+LegalityMasks legality_masks(Position* position)
 {
-  std::vector<uint32_t> pseudolegal_moves;
-  if (position->white_to_move)
+  LegalityMasks masks;
+  uint64_t my_pieces = pieces_of<Us>(position);
+  uint64_t their_pieces = pieces_of<opposite(Us)>(position);
+  uint64_t occupancy = all_occupied(position);
+
+  masks.king_square = bitscan(my_pieces & position->kings);
+  masks.checkers = attackers_to(masks.king_square, occupancy, position) & their_pieces;
+  masks.pinned = 0;
+
+  // Enemy sliders that would see our king if only their own pieces could block
+  uint64_t snipers = ((rook_attacks(their_pieces, masks.king_square) & (position->rooks | position->queens)) |
+                      (bishop_attacks(their_pieces, masks.king_square) & (position->bishops | position->queens))) &
+                     their_pieces;
+
+  while (snipers)
+  {
+    int sniper_square = pop_lsb(snipers);
+    uint64_t blockers = between[masks.king_square][sniper_square] & occupancy;
+
+    // Exactly one piece in the way and it is ours, so it is pinned
+    if (blockers && !(blockers & (blockers - 1)) && (blockers & my_pieces))
+    {
+      masks.pinned |= blockers;
+    }
+  }
+
+  if (!masks.checkers)
   {
-    white_quiet_pawn_moves(position, &pseudolegal_moves);
-    white_king_moves(position, &pseudolegal_moves);
-    white_pawn_attacks(position, &pseudolegal_moves);
-    white_knight_moves(position, &pseudolegal_moves);
+    masks.check_mask = ~0ull;
+  }
+  else if (!(masks.checkers & (masks.checkers - 1)))
+  {
+    masks.check_mask = masks.checkers | between[masks.king_square][bitscan(masks.checkers)];
   }
   else
   {
-    black_quiet_pawn_moves(position, &pseudolegal_moves);
-    black_king_moves(position, &pseudolegal_moves);
-    black_pawn_attacks(position, &pseudolegal_moves);
-    black_knight_moves(position, &pseudolegal_moves);
+    // Double check, only the king can move
+    masks.check_mask = 0;
   }
 
-  bishop_moves(position, &pseudolegal_moves);
-  rook_moves(position, &pseudolegal_moves);
-  queen_moves(position, &pseudolegal_moves);
-  castling_moves(position, &pseudolegal_moves);
+  return masks;
+}
 
-  return pseudolegal_moves;
+LegalityMasks legality_masks(Position* position)
+{
+  return position->white_to_move ? legality_masks<WHITE>(position) : legality_masks<BLACK>(position);
 }
 
 bool validate_move(Position* position, uint32_t move)
@@ -403,528 +449,745 @@ bool validate_move(Position* position, uint32_t move)
   return !is_square_attacked(position->white_to_move, king_position, &intermediate_position);
 }
 
-bool is_a_check(Position* position, uint32_t move)
+template <Color Us>
+bool is_legal_move(Position* position, uint32_t move)
 {
-  Position intermediate_position = make_move(position, move);
-  int king_position =
-      bitscan(position->white_to_move ? black_kings(&intermediate_position) : white_kings(&intermediate_position));
-  bool is_check = is_square_attacked(intermediate_position.white_to_move, king_position, &intermediate_position);
-
-  return is_check;
-}
+  constexpr bool white = Us == WHITE;
+  int from_sq = decode_from_square(move);
+  int to_sq = decode_to_square(move);
+  uint64_t from_square = int_location_to_bitboard(from_sq);
+  uint64_t to_square = int_location_to_bitboard(to_sq);
+  PieceAsInt moved_piece = decode_moved_piece(move);
+  PieceAsInt promotion_piece = decode_promoted_to_piece(move);
+  uint64_t my_pieces = pieces_of<Us>(position);
+  uint64_t their_pieces = pieces_of<opposite(Us)>(position);
+  uint64_t occupancy = all_occupied(position);
 
-std::vector<uint32_t> valid_moves_for_position(Position position)
-{
-  std::vector<uint32_t> pseudolegal_moves = pseudolegal_possible_moves(&position);
-  std::vector<uint32_t> legal_moves;
+  if (moved_piece > KING || !(my_pieces & from_square) ||
+      victim_on_square(position, static_cast<Square>(from_sq)) != moved_piece)
+  {
+    return false;
+  }
 
-  for (uint32_t move : pseudolegal_moves)
+  if (decode_castling(move))
   {
-    if (validate_move(&position, move))
-    {
-      if (is_a_check(&position, move))
-      {
-        legal_moves.push_back(move | move_masks[9]);
-      }
-      else
-      {
-        legal_moves.push_back(move);
-      }
-    }
+    MoveList castles;
+    generate_castling_moves<Us>(position, &castles, king_danger<Us>(position));
+    return std::any_of(castles.begin(), castles.end(), [move](uint32_t castle) { return same_move(castle, move); });
   }
 
-  return legal_moves;
-}
+  if ((my_pieces & to_square) || (their_pieces & position->kings & to_square))
+  {
+    return false;
+  }
 
-void white_quiet_pawn_moves(Position* position, std::vector<uint32_t>* moves)
-{
-  int pawn_location, potential_location;
-  uint64_t white_pawns_in_position = white_pawns(position);
-  uint64_t not_occupied_squares = ~all_occupied(position);
+  // Rebuild the flags this move must carry in this position, a move from another position can disagree on any of them
+  bool enpassant = moved_piece == PAWN && (position->enPassantTarget & to_square);
+  bool capture = (their_pieces & to_square) || enpassant;
+  bool double_push = moved_piece == PAWN && (to_sq - from_sq == 16 || from_sq - to_sq == 16);
+  bool promotion_rank = moved_piece == PAWN && (to_sq < 8 || to_sq > 55);
 
-  while (white_pawns_in_position)
+  if (promotion_rank ? promotion_piece > QUEEN : promotion_piece != NO_PIECE)
+  {
+    return false;
+  }
+  if (!same_move(move, encode_move(from_sq, to_sq, white, moved_piece, promotion_piece, capture, double_push,
+                                   enpassant, false)))
   {
-    pawn_location = bitscan(white_pawns_in_position);
-    potential_location = pawn_location - 8;
+    return false;
+  }
 
-    if (potential_location > -1 && (not_occupied_squares & int_location_to_bitboard(potential_location)))
-    {
-      if (potential_location < 8)
+  uint64_t reachable;
+  switch (moved_piece)
+  {
+    case PAWN:
+      if (capture)
       {
-        moves->push_back(
-            encode_move(pawn_location, potential_location, true, PAWN, KNIGHT, false, false, false, false));
-        moves->push_back(
-            encode_move(pawn_location, potential_location, true, PAWN, BISHOP, false, false, false, false));
-        moves->push_back(encode_move(pawn_location, potential_location, true, PAWN, ROOK, false, false, false, false));
-        moves->push_back(encode_move(pawn_location, potential_location, true, PAWN, QUEEN, false, false, false, false));
+        reachable = pawn_attacks[Us][from_sq];
       }
       else
       {
-        moves->push_back(
-            encode_move(pawn_location, potential_location, true, PAWN, NO_PIECE, false, false, false, false));
-
-        if (potential_location > 39 && potential_location < 48)
+        constexpr int forward = white ? -8 : 8;
+        bool on_start_rank = from_square & (white ? RANK_2 : RANK_7);
+        reachable = int_location_to_bitboard(from_sq + forward) & ~occupancy;
+        if (reachable && on_start_rank)
         {
-          potential_location -= 8;
-          if (not_occupied_squares & int_location_to_bitboard(potential_location))
-          {
-            moves->push_back(
-                encode_move(pawn_location, potential_location, true, PAWN, NO_PIECE, false, true, false, false));
-          }
+          reachable |= int_location_to_bitboard(from_sq + 2 * forward) & ~occupancy;
         }
       }
-    }
+      break;
+    case KNIGHT:
+      reachable = knight_moves[from_sq];
+      break;
+    case BISHOP:
+      reachable = bishop_attacks(occupancy, from_sq);
+      break;
+    case ROOK:
+      reachable = rook_attacks(occupancy, from_sq);
+      break;
+    case QUEEN:
+      reachable = queen_attacks(occupancy, from_sq);
+      break;
+    default:
+      reachable = king_moves[from_sq];
+      break;
+  }
 
-    white_pawns_in_position = set_bit_low(white_pawns_in_position, pawn_location);
+  if (!(reachable & to_square))
+  {
+    return false;
+  }
+
+  if (moved_piece == KING)
+  {
+    return !(attackers_to(to_sq, occupancy ^ from_square, position) & their_pieces);
   }
+  if (enpassant)
+  {
+    return validate_move(position, move);
+  }
+
+  return legal_destinations(from_sq, legality_masks<Us>(position)) & to_square;
 }
 
-void black_quiet_pawn_moves(Position* position, std::vector<uint32_t>* moves)
+bool is_legal_move(Position* position, uint32_t move)
 {
-  int pawn_location, potential_location;
-  uint64_t black_pawns_in_position = black_pawns(position);
-  uint64_t not_occupied_squares = ~all_occupied(position);
+  return position->white_to_move ? is_legal_move<WHITE>(position, move) : is_legal_move<BLACK>(position, move);
+}
 
-  while (black_pawns_in_position)
+template <Color Us>
+CheckInfo check_info(Position* position)
+{
+  CheckInfo info;
+  uint64_t my_pieces = pieces_of<Us>(position);
+  uint64_t their_pieces = pieces_of<opposite(Us)>(position);
+  uint64_t occupancy = all_occupied(position);
+
+  info.enemy_king_square = bitscan(their_pieces & position->kings);
+
+  // A pawn of ours checks from the squares an enemy pawn on the king square would attack
+  info.check_squares[PAWN] = pawn_attacks[opposite(Us)][info.enemy_king_square];
+  info.check_squares[KNIGHT] = knight_moves[info.enemy_king_square];
+  info.check_squares[BISHOP] = bishop_attacks(occupancy, info.enemy_king_square);
+  info.check_squares[ROOK] = rook_attacks(occupancy, info.enemy_king_square);
+  info.check_squares[QUEEN] = info.check_squares[BISHOP] | info.check_squares[ROOK];
+  info.check_squares[KING] = 0;
+
+  // Our sliders lined up with the enemy king on an otherwise empty board
+  uint64_t snipers = ((rook_attacks(0, info.enemy_king_square) & (position->rooks | position->queens)) |
+                      (bishop_attacks(0, info.enemy_king_square) & (position->bishops | position->queens))) &
+                     my_pieces;
+  info.discovered_check_candidates = 0;
+
+  while (snipers)
   {
-    pawn_location = bitscan(black_pawns_in_position);
-    potential_location = pawn_location + 8;
+    int sniper_square = pop_lsb(snipers);
+    uint64_t blockers = between[info.enemy_king_square][sniper_square] & occupancy;
 
-    if (potential_location < 64 && (not_occupied_squares & int_location_to_bitboard(potential_location)))
+    // Moving a lone blocker of ours off the line uncovers the slider behind it
+    if (blockers && !(blockers & (blockers - 1)) && (blockers & my_pieces))
     {
-      if (potential_location > 55)
-      {
-        moves->push_back(
-            encode_move(pawn_location, potential_location, false, PAWN, KNIGHT, false, false, false, false));
-        moves->push_back(
-            encode_move(pawn_location, potential_location, false, PAWN, BISHOP, false, false, false, false));
-        moves->push_back(encode_move(pawn_location, potential_location, false, PAWN, ROOK, false, false, false, false));
-        moves->push_back(
-            encode_move(pawn_location, potential_location, false, PAWN, QUEEN, false, false, false, false));
-      }
-      else
-      {
-        moves->push_back(
-            encode_move(pawn_location, potential_location, false, PAWN, NO_PIECE, false, false, false, false));
-
-        if (potential_location > 15 && potential_location < 24)
-        {
-          potential_location += 8;
-          if (not_occupied_squares & int_location_to_bitboard(potential_location))
-          {
-            moves->push_back(
-                encode_move(pawn_location, potential_location, false, PAWN, NO_PIECE, false, true, false, false));
-          }
-        }
-      }
+      info.discovered_check_candidates |= blockers;
     }
-
-    black_pawns_in_position = set_bit_low(black_pawns_in_position, pawn_location);
   }
+
+  return info;
 }
 
-void white_pawn_attacks(Position* position, std::vector<uint32_t>* moves)
+CheckInfo check_info(Position* position)
 {
-  int white_pawn_location, white_pawn_attack_location;
-  uint64_t white_pawn_locations = white_pawns(position);
-  uint64_t black_no_king = black_occupied_no_king(position);
-  uint64_t potential_white_pawn_attack_bitboard;
-  uint64_t targets = black_no_king | position->enPassantTarget;
+  return position->white_to_move ? check_info<WHITE>(position) : check_info<BLACK>(position);
+}
 
-  while (white_pawn_locations)
-  {
-    white_pawn_location = bitscan(white_pawn_locations);
-    white_pawn_attack_location = white_pawn_location - 7;
+template <Color Us>
+bool gives_check(Position* position, const CheckInfo& info, uint32_t move)
+{
+  int from_sq = decode_from_square(move);
+  int to_sq = decode_to_square(move);
+  uint64_t from_square = int_location_to_bitboard(from_sq);
+  uint64_t to_square = int_location_to_bitboard(to_sq);
+  PieceAsInt moved_piece = decode_moved_piece(move);
+  PieceAsInt promotion_piece = decode_promoted_to_piece(move);
 
-    if (white_pawn_attack_location > -1)
-    {
-      potential_white_pawn_attack_bitboard = int_location_to_bitboard(white_pawn_attack_location);
+  // Direct check
+  if (promotion_piece == NO_PIECE && (info.check_squares[moved_piece] & to_square))
+  {
+    return true;
+  }
 
-      if ((targets & potential_white_pawn_attack_bitboard) && (white_pawn_location % 8 != 7))
-      {
-        if (white_pawn_attack_location < 8)
-        {
-          moves->push_back(encode_move(white_pawn_location, white_pawn_attack_location, true, PAWN, KNIGHT, true, false,
-                                       position->enPassantTarget & int_location_to_bitboard(white_pawn_attack_location),
-                                       false));
-          moves->push_back(encode_move(white_pawn_location, white_pawn_attack_location, true, PAWN, BISHOP, true, false,
-                                       position->enPassantTarget & int_location_to_bitboard(white_pawn_attack_location),
-                                       false));
-          moves->push_back(encode_move(white_pawn_location, white_pawn_attack_location, true, PAWN, ROOK, true, false,
-                                       position->enPassantTarget & int_location_to_bitboard(white_pawn_attack_location),
-                                       false));
-          moves->push_back(encode_move(white_pawn_location, white_pawn_attack_location, true, PAWN, QUEEN, true, false,
-                                       position->enPassantTarget & int_location_to_bitboard(white_pawn_attack_location),
-                                       false));
-        }
-        else
-        {
-          moves->push_back(
-              encode_move(white_pawn_location, white_pawn_attack_location, true, PAWN, NO_PIECE, true, false,
-                          position->enPassantTarget & int_location_to_bitboard(white_pawn_attack_location), false));
-        }
-      }
+  // Discovered check, the moving piece leaves the line between our slider and their king
+  if ((info.discovered_check_candidates & from_square) &&
+      !(line_through[from_sq][info.enemy_king_square] & to_square))
+  {
+    return true;
+  }
 
-      white_pawn_attack_location -= 2;
+  uint64_t my_pieces = pieces_of<Us>(position);
+  uint64_t occupancy = all_occupied(position) ^ from_square;
 
-      potential_white_pawn_attack_bitboard = int_location_to_bitboard(white_pawn_attack_location);
-      if (white_pawn_attack_location > -1 && (white_pawn_location % 8 != 0) &&
-          (targets & potential_white_pawn_attack_bitboard))
-      {
-        if (white_pawn_attack_location < 8)
-        {
-          moves->push_back(encode_move(white_pawn_location, white_pawn_attack_location, true, PAWN, KNIGHT, true, false,
-                                       position->enPassantTarget & int_location_to_bitboard(white_pawn_attack_location),
-                                       false));
-          moves->push_back(encode_move(white_pawn_location, white_pawn_attack_location, true, PAWN, BISHOP, true, false,
-                                       position->enPassantTarget & int_location_to_bitboard(white_pawn_attack_location),
-                                       false));
-          moves->push_back(encode_move(white_pawn_location, white_pawn_attack_location, true, PAWN, ROOK, true, false,
-                                       position->enPassantTarget & int_location_to_bitboard(white_pawn_attack_location),
-                                       false));
-          moves->push_back(encode_move(white_pawn_location, white_pawn_attack_location, true, PAWN, QUEEN, true, false,
-                                       position->enPassantTarget & int_location_to_bitboard(white_pawn_attack_location),
-                                       false));
-        }
-        else
-        {
-          moves->push_back(
-              encode_move(white_pawn_location, white_pawn_attack_location, true, PAWN, NO_PIECE, true, false,
-                          position->enPassantTarget & int_location_to_bitboard(white_pawn_attack_location), false));
-        }
-      }
+  if (promotion_piece != NO_PIECE)
+  {
+    // The promoted piece attacks from the promotion square with the pawn gone from its origin
+    uint64_t enemy_king = int_location_to_bitboard(info.enemy_king_square);
+    switch (promotion_piece)
+    {
+      case KNIGHT:
+        return knight_moves[to_sq] & enemy_king;
+      case BISHOP:
+        return bishop_attacks(occupancy, to_sq) & enemy_king;
+      case ROOK:
+        return rook_attacks(occupancy, to_sq) & enemy_king;
+      case QUEEN:
+        return queen_attacks(occupancy, to_sq) & enemy_king;
+      default:
+        return false;
     }
+  }
 
-    white_pawn_locations = set_bit_low(white_pawn_locations, white_pawn_location);
+  if (decode_enpassant(move))
+  {
+    // Both pawns leave their squares, which can open a rank or diagonal to the king
+    uint64_t captured_square = Us == WHITE ? to_square << 8 : to_square >> 8;
+    occupancy = (occupancy ^ captured_square) | to_square;
+    return (rook_attacks(occupancy, info.enemy_king_square) & (position->rooks | position->queens) & my_pieces) |
+           (bishop_attacks(occupancy, info.enemy_king_square) & (position->bishops | position->queens) & my_pieces);
+  }
+
+  if (decode_castling(move))
+  {
+    // Only the castled rook can give check, from its square next to the king
+    int rook_from_sq = to_sq > from_sq ? from_sq + 3 : from_sq - 4;
+    int rook_to_sq = to_sq > from_sq ? from_sq + 1 : from_sq - 1;
+    occupancy = (occupancy ^ int_location_to_bitboard(rook_from_sq)) | to_square | int_location_to_bitboard(rook_to_sq);
+    return rook_attacks(occupancy, rook_to_sq) & int_location_to_bitboard(info.enemy_king_square);
   }
+
+  return false;
 }
 
-void black_pawn_attacks(Position* position, std::vector<uint32_t>* moves)
+bool gives_check(Position* position, const CheckInfo& info, uint32_t move)
 {
-  int black_pawn_location, black_pawn_attack_location;
-  uint64_t black_pawn_locations = black_pawns(position);
-  uint64_t white_no_king = white_occupied_no_king(position);
-  uint64_t potential_black_pawn_attack_bitboard;
-  uint64_t targets = white_no_king | position->enPassantTarget;
+  return position->white_to_move ? gives_check<WHITE>(position, info, move) : gives_check<BLACK>(position, info, move);
+}
 
-  while (black_pawn_locations)
+// Destination squares allowed for each piece type (PieceAsInt) in one generation pass
+struct GenerationTargets
+{
+  std::array<uint64_t, 6> pieces;  // The PAWN entry holds push destinations
+  uint64_t pawn_captures;          // Pawn capture destinations, en passant is always included when captures are
+  bool castling;
+};
+
+template <Color Us>
+static void generate_with_targets(Position* position, MoveList* moves, const LegalityMasks& masks,
+                                  const GenerationTargets& targets)
+{
+  // Only the king can answer a double check
+  if (masks.check_mask != 0)
   {
-    black_pawn_location = bitscan(black_pawn_locations);
-    black_pawn_attack_location = black_pawn_location + 7;
-
-    if (black_pawn_attack_location < 64)
+    if (targets.pieces[PAWN])
     {
-      potential_black_pawn_attack_bitboard = int_location_to_bitboard(black_pawn_attack_location);
-      if ((targets & potential_black_pawn_attack_bitboard) && (black_pawn_location % 8 != 0))
-      {
-        if (black_pawn_attack_location > 55)
-        {
-          moves->push_back(encode_move(black_pawn_location, black_pawn_attack_location, true, PAWN, KNIGHT, true, false,
-                                       position->enPassantTarget & int_location_to_bitboard(black_pawn_attack_location),
-                                       false));
-          moves->push_back(encode_move(black_pawn_location, black_pawn_attack_location, true, PAWN, BISHOP, true, false,
-                                       position->enPassantTarget & int_location_to_bitboard(black_pawn_attack_location),
-                                       false));
-          moves->push_back(encode_move(black_pawn_location, black_pawn_attack_location, true, PAWN, ROOK, true, false,
-                                       position->enPassantTarget & int_location_to_bitboard(black_pawn_attack_location),
-                                       false));
-          moves->push_back(encode_move(black_pawn_location, black_pawn_attack_location, true, PAWN, QUEEN, true, false,
-                                       position->enPassantTarget & int_location_to_bitboard(black_pawn_attack_location),
-                                       false));
-        }
-        else
-        {
-          moves->push_back(
-              encode_move(black_pawn_location, black_pawn_attack_location, true, PAWN, NO_PIECE, true, false,
-                          position->enPassantTarget & int_location_to_bitboard(black_pawn_attack_location), false));
-        }
-      }
+      generate_pawn_pushes<Us>(position, moves, masks, targets.pieces[PAWN]);
+    }
+    if (targets.pawn_captures)
+    {
+      generate_pawn_captures<Us>(position, moves, masks, targets.pawn_captures);
+    }
+    if (targets.pieces[KNIGHT])
+    {
+      generate_knight_moves<Us>(position, moves, masks, targets.pieces[KNIGHT]);
+    }
+    if (targets.pieces[BISHOP])
+    {
+      generate_slider_moves<Us, BISHOP>(position, moves, masks, targets.pieces[BISHOP]);
+    }
+    if (targets.pieces[ROOK])
+    {
+      generate_slider_moves<Us, ROOK>(position, moves, masks, targets.pieces[ROOK]);
+    }
+    if (targets.pieces[QUEEN])
+    {
+      generate_slider_moves<Us, QUEEN>(position, moves, masks, targets.pieces[QUEEN]);
+    }
+  }
+  uint64_t attacked = king_danger<Us>(position);
+  generate_king_moves<Us>(position, moves, attacked, targets.pieces[KING]);
+  if (targets.castling)
+  {
+    generate_castling_moves<Us>(position, moves, attacked);
+  }
+}
 
-      black_pawn_attack_location += 2;
-      potential_black_pawn_attack_bitboard = int_location_to_bitboard(black_pawn_attack_location);
-      if (black_pawn_attack_location < 64 && (targets & potential_black_pawn_attack_bitboard) &&
-          (black_pawn_location % 8 != 7))
+template <Color Us>
+MoveList generate_moves(Position* position, GenerationType type)
+{
+  LegalityMasks masks = legality_masks<Us>(position);
+  CheckInfo info = check_info<Us>(position);
+  uint64_t my_pieces = pieces_of<Us>(position);
+  uint64_t their_pieces = pieces_of<opposite(Us)>(position);
+  uint64_t empty = ~all_occupied(position);
+  constexpr uint64_t promotion_rank = Us == WHITE ? RANK_8 : RANK_1;
+  GenerationTargets targets;
+
+  switch (type)
+  {
+    case CAPTURES:
+      targets.pieces.fill(their_pieces);
+      targets.pieces[PAWN] = promotion_rank;
+      targets.pawn_captures = their_pieces;
+      targets.castling = false;
+      break;
+    case QUIETS:
+      targets.pieces.fill(empty);
+      targets.pieces[PAWN] = ~promotion_rank;
+      targets.pawn_captures = 0;
+      targets.castling = true;
+      break;
+    case QUIET_CHECKS:
+      targets.pieces.fill(empty);
+      targets.pieces[PAWN] = ~promotion_rank;
+      targets.pawn_captures = 0;
+      targets.castling = true;
+      // Without a piece that can uncover a check, only moves onto the check squares can give check
+      if (!info.discovered_check_candidates)
       {
-        if (black_pawn_attack_location > 55)
-        {
-          moves->push_back(encode_move(black_pawn_location, black_pawn_attack_location, true, PAWN, KNIGHT, true, false,
-                                       position->enPassantTarget & int_location_to_bitboard(black_pawn_attack_location),
-                                       false));
-          moves->push_back(encode_move(black_pawn_location, black_pawn_attack_location, true, PAWN, BISHOP, true, false,
-                                       position->enPassantTarget & int_location_to_bitboard(black_pawn_attack_location),
-                                       false));
-          moves->push_back(encode_move(black_pawn_location, black_pawn_attack_location, true, PAWN, ROOK, true, false,
-                                       position->enPassantTarget & int_location_to_bitboard(black_pawn_attack_location),
-                                       false));
-          moves->push_back(encode_move(black_pawn_location, black_pawn_attack_location, true, PAWN, QUEEN, true, false,
-                                       position->enPassantTarget & int_location_to_bitboard(black_pawn_attack_location),
-                                       false));
-        }
-        else
+        for (int piece = KNIGHT; piece <= KING; piece++)
         {
-          moves->push_back(
-              encode_move(black_pawn_location, black_pawn_attack_location, true, PAWN, NO_PIECE, true, false,
-                          position->enPassantTarget & int_location_to_bitboard(black_pawn_attack_location), false));
+          targets.pieces[piece] &= info.check_squares[piece];
         }
       }
-    }
+      break;
+    default:
+      targets.pieces.fill(~my_pieces);
+      targets.pawn_captures = their_pieces;
+      // Castling out of check is never legal
+      targets.castling = type == ALL_LEGAL;
+      break;
+  }
 
-    black_pawn_locations = set_bit_low(black_pawn_locations, black_pawn_location);
+  MoveList generated_moves;
+  MoveList moves;
+  generate_with_targets<Us>(position, &generated_moves, masks, targets);
+
+  // Generated moves are already legal, only the check flag is left to set
+  for (uint32_t move : generated_moves)
+  {
+    if (gives_check<Us>(position, info, move))
+    {
+      moves.push_back(move | move_masks[9]);
+    }
+    else if (type != QUIET_CHECKS)
+    {
+      moves.push_back(move);
+    }
   }
+
+  return moves;
 }
 
-void white_king_moves(Position* position, std::vector<uint32_t>* moves)
+MoveList generate_moves(Position* position, GenerationType type)
 {
-  int king_location = bitscan(white_kings(position));
-  uint64_t to_square_candidates = king_moves[king_location] & (~all_occupied(position));
-  int to_square;
+  return position->white_to_move ? generate_moves<WHITE>(position, type) : generate_moves<BLACK>(position, type);
+}
 
-  while (to_square_candidates)
-  {
-    to_square = bitscan(to_square_candidates);
-    moves->push_back(encode_move(king_location, to_square, true, KING, NO_PIECE, false, false, false, false));
-    to_square_candidates = set_bit_low(to_square_candidates, to_square);
-  }
+MoveList valid_moves_for_position(Position position) { return generate_moves(&position, ALL_LEGAL); }
 
-  to_square_candidates = king_moves[king_location] & black_occupied_no_king(position);
+// Whole-set pawn shifts, forward and capturing towards the a and h files
+template <Color Us>
+static constexpr uint64_t pawn_push_targets(uint64_t pawns)
+{
+  return Us == WHITE ? pawns >> 8 : pawns << 8;
+}
 
-  while (to_square_candidates)
-  {
-    to_square = bitscan(to_square_candidates);
-    moves->push_back(encode_move(king_location, to_square, true, KING, NO_PIECE, true, false, false, false));
-    to_square_candidates = set_bit_low(to_square_candidates, to_square);
-  }
+template <Color Us>
+static constexpr uint64_t pawn_capture_targets_a_side(uint64_t pawns)
+{
+  return Us == WHITE ? (pawns & NOT_FILE_A) >> 9 : (pawns & NOT_FILE_A) << 7;
 }
 
-void black_king_moves(Position* position, std::vector<uint32_t>* moves)
+template <Color Us>
+static constexpr uint64_t pawn_capture_targets_h_side(uint64_t pawns)
 {
-  int king_location = bitscan(black_kings(position));
-  uint64_t to_square_candidates = king_moves[king_location] & (~all_occupied(position));
-  int to_square;
+  return Us == WHITE ? (pawns & NOT_FILE_H) >> 7 : (pawns & NOT_FILE_H) << 9;
+}
 
-  while (to_square_candidates)
+// Pawn moves onto the last rank count once per promotion piece
+template <Color Us>
+static inline int count_pawn_destinations(uint64_t destinations)
+{
+  constexpr uint64_t promotion_rank = Us == WHITE ? RANK_8 : RANK_1;
+  return bitcount(destinations & ~promotion_rank) + 4 * bitcount(destinations & promotion_rank);
+}
+
+template <Color Us>
+int count_legal_moves(Position* position)
+{
+  constexpr uint64_t double_push_rank = Us == WHITE ? RANK_3 : RANK_6;
+
+  LegalityMasks masks = legality_masks<Us>(position);
+  uint64_t my_pieces = pieces_of<Us>(position);
+  uint64_t occupancy = all_occupied(position);
+  uint64_t empty = ~occupancy;
+  // Same as the generators, the enemy king is never a target
+  uint64_t targets = ~my_pieces & ~position->kings;
+  uint64_t attacked = king_danger<Us>(position);
+
+  int count = bitcount(king_moves[masks.king_square] & targets & ~attacked);
+  if (!masks.checkers)
   {
-    to_square = bitscan(to_square_candidates);
-    moves->push_back(encode_move(king_location, to_square, false, KING, NO_PIECE, false, false, false, false));
-    to_square_candidates = set_bit_low(to_square_candidates, to_square);
+    MoveList castles;
+    generate_castling_moves<Us>(position, &castles, attacked);
+    count += castles.size();
   }
 
-  to_square_candidates = king_moves[king_location] & white_occupied_no_king(position);
+  // Only the king can answer a double check
+  if (!masks.check_mask)
+  {
+    return count;
+  }
 
-  while (to_square_candidates)
+  uint64_t knights = my_pieces & position->knights & ~masks.pinned;
+  while (knights)
   {
-    to_square = bitscan(to_square_candidates);
-    moves->push_back(encode_move(king_location, to_square, false, KING, NO_PIECE, true, false, false, false));
-    to_square_candidates = set_bit_low(to_square_candidates, to_square);
+    count += bitcount(knight_moves[pop_lsb(knights)] & targets & masks.check_mask);
   }
-}
 
-void white_knight_moves(Position* position, std::vector<uint32_t>* moves)
-{
-  uint64_t white_knights_in_position = white_knights(position);
+  // A queen's diagonal and straight moves never overlap, so it is counted once as each
+  uint64_t diagonal_sliders = my_pieces & (position->bishops | position->queens);
+  while (diagonal_sliders)
+  {
+    int square = pop_lsb(diagonal_sliders);
+    count += bitcount(bishop_attacks(occupancy, square) & targets & legal_destinations(square, masks));
+  }
+  uint64_t straight_sliders = my_pieces & (position->rooks | position->queens);
+  while (straight_sliders)
+  {
+    int square = pop_lsb(straight_sliders);
+    count += bitcount(rook_attacks(occupancy, square) & targets & legal_destinations(square, masks));
+  }
+
+  // Unpinned pawns move as a set, pinned ones one at a time along their pin
+  uint64_t pawns = my_pieces & position->pawns;
+  uint64_t pawn_targets = pieces_of<opposite(Us)>(position) & ~position->kings;
+  uint64_t free_pawns = pawns & ~masks.pinned;
+  uint64_t single_pushes = pawn_push_targets<Us>(free_pawns) & empty;
+  uint64_t double_pushes = pawn_push_targets<Us>(single_pushes & double_push_rank) & empty;
+
+  count += count_pawn_destinations<Us>(single_pushes & masks.check_mask);
+  count += bitcount(double_pushes & masks.check_mask);
+  count += count_pawn_destinations<Us>(pawn_capture_targets_a_side<Us>(free_pawns) & pawn_targets & masks.check_mask);
+  count += count_pawn_destinations<Us>(pawn_capture_targets_h_side<Us>(free_pawns) & pawn_targets & masks.check_mask);
 
-  while (white_knights_in_position)
+  uint64_t pinned_pawns = pawns & masks.pinned;
+  while (pinned_pawns)
   {
-    int knight_location = bitscan(white_knights_in_position);
-    uint64_t to_square_candidates = knight_moves[knight_location] & (~all_occupied(position));
-    int to_square;
+    int square = pop_lsb(pinned_pawns);
+    uint64_t pawn = int_location_to_bitboard(square);
+    uint64_t destinations = legal_destinations(square, masks);
+    uint64_t single_push = pawn_push_targets<Us>(pawn) & empty;
+    uint64_t double_push = pawn_push_targets<Us>(single_push & double_push_rank) & empty;
+
+    count += count_pawn_destinations<Us>((single_push | (pawn_attacks[Us][square] & pawn_targets)) & destinations);
+    count += bitcount(double_push & destinations);
+  }
 
-    while (to_square_candidates)
+  // En passant can uncover the king along the rank, so each capture is tried on the board
+  if (position->enPassantTarget)
+  {
+    int target_square = bitscan(position->enPassantTarget);
+    uint64_t capturers = pawn_attacks[opposite(Us)][target_square] & pawns;
+    while (capturers)
     {
-      to_square = bitscan(to_square_candidates);
-      moves->push_back(encode_move(knight_location, to_square, true, KNIGHT, NO_PIECE, false, false, false, false));
-      to_square_candidates = set_bit_low(to_square_candidates, to_square);
+      uint32_t move =
+          encode_move(pop_lsb(capturers), target_square, Us == WHITE, PAWN, NO_PIECE, true, false, true, false);
+      count += validate_move(position, move);
     }
+  }
 
-    to_square_candidates = knight_moves[knight_location] & black_occupied_no_king(position);
+  return count;
+}
 
-    while (to_square_candidates)
-    {
-      to_square = bitscan(to_square_candidates);
-      moves->push_back(encode_move(knight_location, to_square, true, KNIGHT, NO_PIECE, true, false, false, false));
-      to_square_candidates = set_bit_low(to_square_candidates, to_square);
-    }
+int count_legal_moves(Position* position)
+{
+  return position->white_to_move ? count_legal_moves<WHITE>(position) : count_legal_moves<BLACK>(position);
+}
+
+bool is_in_check(Position* position)
+{
+  uint64_t my_pieces = position->white_to_move ? position->white : position->black;
+  uint64_t their_pieces = position->white_to_move ? position->black : position->white;
 
-    white_knights_in_position = set_bit_low(white_knights_in_position, knight_location);
+  return attackers_to(bitscan(my_pieces & position->kings), all_occupied(position), position) & their_pieces;
+}
+
+// A pawn reaching the last rank becomes each of the four pieces in turn
+template <Color Us>
+static inline void push_promotions(MoveList* moves, int from_square, int to_square, bool capture)
+{
+  for (PieceAsInt piece : {KNIGHT, BISHOP, ROOK, QUEEN})
+  {
+    moves->push_back(encode_move(from_square, to_square, Us == WHITE, PAWN, piece, capture, false, false, false));
   }
 }
 
-void black_knight_moves(Position* position, std::vector<uint32_t>* moves)
+template <Color Us>
+void generate_pawn_pushes(Position* position, MoveList* moves, const LegalityMasks& masks, uint64_t target_mask)
 {
-  uint64_t black_knights_in_position = black_knights(position);
+  constexpr int forward = Us == WHITE ? -8 : 8;
+  constexpr uint64_t promotion_rank = Us == WHITE ? RANK_8 : RANK_1;
+  // Single push destinations of pawns still on their starting rank
+  constexpr uint64_t double_push_rank = Us == WHITE ? RANK_3 : RANK_6;
 
-  while (black_knights_in_position)
+  int pawn_location, potential_location;
+  uint64_t pawns = pieces_of<Us>(position) & position->pawns;
+  uint64_t not_occupied_squares = ~all_occupied(position);
+  uint64_t legal_targets, push_square;
+
+  while (pawns)
   {
-    int knight_location = bitscan(black_knights_in_position);
-    uint64_t to_square_candidates = knight_moves[knight_location] & (~all_occupied(position));
-    int to_square;
+    pawn_location = pop_lsb(pawns);
+    potential_location = pawn_location + forward;
+    push_square = int_location_to_bitboard(potential_location);
+    legal_targets = legal_destinations(pawn_location, masks) & target_mask;
 
-    while (to_square_candidates)
+    if (not_occupied_squares & push_square)
     {
-      to_square = bitscan(to_square_candidates);
-      moves->push_back(encode_move(knight_location, to_square, false, KNIGHT, NO_PIECE, false, false, false, false));
-      to_square_candidates = set_bit_low(to_square_candidates, to_square);
-    }
-
-    to_square_candidates = knight_moves[knight_location] & white_occupied_no_king(position);
+      if (push_square & promotion_rank)
+      {
+        if (legal_targets & push_square)
+        {
+          push_promotions<Us>(moves, pawn_location, potential_location, false);
+        }
+      }
+      else
+      {
+        if (legal_targets & push_square)
+        {
+          moves->push_back(
+              encode_move(pawn_location, potential_location, Us == WHITE, PAWN, NO_PIECE, false, false, false, false));
+        }
 
-    while (to_square_candidates)
-    {
-      to_square = bitscan(to_square_candidates);
-      moves->push_back(encode_move(knight_location, to_square, false, KNIGHT, NO_PIECE, true, false, false, false));
-      to_square_candidates = set_bit_low(to_square_candidates, to_square);
+        // The double push can be legal even when the single push is not (it may block a check)
+        if (push_square & double_push_rank)
+        {
+          potential_location += forward;
+          if (not_occupied_squares & legal_targets & int_location_to_bitboard(potential_location))
+          {
+            moves->push_back(
+                encode_move(pawn_location, potential_location, Us == WHITE, PAWN, NO_PIECE, false, true, false, false));
+          }
+        }
+      }
     }
-
-    black_knights_in_position = set_bit_low(black_knights_in_position, knight_location);
   }
 }
 
-void bishop_moves(Position* position, std::vector<uint32_t>* moves)
+template <Color Us>
+void generate_pawn_captures(Position* position, MoveList* moves, const LegalityMasks& masks, uint64_t target_mask)
 {
-  bool white = position->white_to_move;
-  int bishop_location, target_location;
-  uint64_t occupancy = all_occupied(position);
-  uint64_t my_pieces = white ? position->white : position->black;
-  uint64_t bishops = white ? white_bishops(position) : black_bishops(position);
-  uint64_t opponent_no_king = white ? black_occupied_no_king(position) : white_occupied_no_king(position);
-  uint64_t quiet_moves, attacks;
+  constexpr uint64_t promotion_rank = Us == WHITE ? RANK_8 : RANK_1;
 
-  while (bishops)
+  int pawn_location, target_location;
+  uint64_t pawns = pieces_of<Us>(position) & position->pawns;
+  uint64_t targets = (pieces_of<opposite(Us)>(position) & ~position->kings & target_mask) | position->enPassantTarget;
+  uint64_t attacks;
+  uint32_t move;
+
+  while (pawns)
   {
-    bishop_location = bitscan(bishops);
-    quiet_moves = bishop_attacks(occupancy, bishop_location);
-    attacks = quiet_moves & opponent_no_king;
-    quiet_moves &= ~(my_pieces | attacks);
+    pawn_location = pop_lsb(pawns);
+    // En passant captures are checked separately below, they can expose the king along the rank
+    attacks = pawn_attacks[Us][pawn_location] & targets &
+              (legal_destinations(pawn_location, masks) | position->enPassantTarget);
 
     while (attacks)
     {
-      target_location = bitscan(attacks);
-      moves->push_back(
-          encode_move(bishop_location, target_location, white, BISHOP, NO_PIECE, true, false, false, false));
-      attacks = set_bit_low(attacks, target_location);
+      target_location = pop_lsb(attacks);
+      if (int_location_to_bitboard(target_location) & promotion_rank)
+      {
+        push_promotions<Us>(moves, pawn_location, target_location, true);
+      }
+      else
+      {
+        bool enpassant = position->enPassantTarget & int_location_to_bitboard(target_location);
+        move = encode_move(pawn_location, target_location, Us == WHITE, PAWN, NO_PIECE, true, false, enpassant, false);
+        if (!enpassant || validate_move(position, move))
+        {
+          moves->push_back(move);
+        }
+      }
     }
+  }
+}
 
-    while (quiet_moves)
-    {
-      target_location = bitscan(quiet_moves);
-      moves->push_back(
-          encode_move(bishop_location, target_location, white, BISHOP, NO_PIECE, false, false, false, false));
-      quiet_moves = set_bit_low(quiet_moves, target_location);
-    }
+template <Color Us>
+void generate_king_moves(Position* position, MoveList* moves, uint64_t attacked, uint64_t target_mask)
+{
+  int king_location = bitscan(pieces_of<Us>(position) & position->kings);
+  uint64_t safe_squares = king_moves[king_location] & ~attacked & target_mask;
+  uint64_t to_square_candidates = safe_squares & (~all_occupied(position));
+  uint64_t their_pieces = pieces_of<opposite(Us)>(position);
+  int to_square;
+
+  while (to_square_candidates)
+  {
+    to_square = pop_lsb(to_square_candidates);
+    moves->push_back(encode_move(king_location, to_square, Us == WHITE, KING, NO_PIECE, false, false, false, false));
+  }
+
+  to_square_candidates = safe_squares & their_pieces & ~position->kings;
 
-    bishops = set_bit_low(bishops, bishop_location);
+  while (to_square_candidates)
+  {
+    to_square = pop_lsb(to_square_candidates);
+    moves->push_back(encode_move(king_location, to_square, Us == WHITE, KING, NO_PIECE, true, false, false, false));
   }
 }
 
-void rook_moves(Position* position, std::vector<uint32_t>* moves)
+template <Color Us>
+void generate_knight_moves(Position* position, MoveList* moves, const LegalityMasks& masks, uint64_t target_mask)
 {
-  bool white = position->white_to_move;
-  int rook_location, target_location;
-  uint64_t occupancy = all_occupied(position);
-  uint64_t my_pieces = white ? position->white : position->black;
-  uint64_t rooks = white ? white_rooks(position) : black_rooks(position);
-  uint64_t opponent_no_king = white ? black_occupied_no_king(position) : white_occupied_no_king(position);
-  uint64_t quiet_moves, attacks;
+  // A pinned knight can never move without exposing the king
+  uint64_t knights = pieces_of<Us>(position) & position->knights & ~masks.pinned;
+  uint64_t opponent_no_king = pieces_of<opposite(Us)>(position) & ~position->kings;
 
-  while (rooks)
+  while (knights)
   {
-    rook_location = bitscan(rooks);
-    quiet_moves = rook_attacks(occupancy, rook_location);
-    attacks = quiet_moves & opponent_no_king;
-    quiet_moves &= ~(my_pieces | attacks);
+    int knight_location = pop_lsb(knights);
+    uint64_t to_square_candidates =
+        knight_moves[knight_location] & (~all_occupied(position)) & masks.check_mask & target_mask;
+    int to_square;
 
-    while (attacks)
+    while (to_square_candidates)
     {
-      target_location = bitscan(attacks);
-      moves->push_back(encode_move(rook_location, target_location, white, ROOK, NO_PIECE, true, false, false, false));
-      attacks = set_bit_low(attacks, target_location);
+      to_square = pop_lsb(to_square_candidates);
+      moves->push_back(
+          encode_move(knight_location, to_square, Us == WHITE, KNIGHT, NO_PIECE, false, false, false, false));
     }
 
-    while (quiet_moves)
+    to_square_candidates = knight_moves[knight_location] & opponent_no_king & masks.check_mask & target_mask;
+
+    while (to_square_candidates)
     {
-      target_location = bitscan(quiet_moves);
-      moves->push_back(encode_move(rook_location, target_location, white, ROOK, NO_PIECE, false, false, false, false));
-      quiet_moves = set_bit_low(quiet_moves, target_location);
+      to_square = pop_lsb(to_square_candidates);
+      moves->push_back(
+          encode_move(knight_location, to_square, Us == WHITE, KNIGHT, NO_PIECE, true, false, false, false));
     }
-
-    rooks = set_bit_low(rooks, rook_location);
   }
 }
 
-void queen_moves(Position* position, std::vector<uint32_t>* moves)
+template <Color Us, PieceAsInt Piece>
+void generate_slider_moves(Position* position, MoveList* moves, const LegalityMasks& masks, uint64_t target_mask)
 {
-  bool white = position->white_to_move;
-  int queen_location, target_location;
+  static_assert(Piece == BISHOP || Piece == ROOK || Piece == QUEEN);
+
+  int slider_location, target_location;
   uint64_t occupancy = all_occupied(position);
-  uint64_t my_pieces = white ? position->white : position->black;
-  uint64_t queens = white ? white_queens(position) : black_queens(position);
-  uint64_t opponent_no_king = white ? black_occupied_no_king(position) : white_occupied_no_king(position);
+  uint64_t my_pieces = pieces_of<Us>(position);
+  uint64_t opponent_no_king = pieces_of<opposite(Us)>(position) & ~position->kings;
   uint64_t quiet_moves, attacks;
+  uint64_t sliders = my_pieces & (Piece == BISHOP ? position->bishops
+                                  : Piece == ROOK ? position->rooks
+                                                  : position->queens);
 
-  while (queens)
+  while (sliders)
   {
-    queen_location = bitscan(queens);
-    quiet_moves = queen_attacks(occupancy, queen_location);
+    slider_location = pop_lsb(sliders);
+    if constexpr (Piece == BISHOP)
+    {
+      quiet_moves = bishop_attacks(occupancy, slider_location);
+    }
+    else if constexpr (Piece == ROOK)
+    {
+      quiet_moves = rook_attacks(occupancy, slider_location);
+    }
+    else
+    {
+      quiet_moves = queen_attacks(occupancy, slider_location);
+    }
+    quiet_moves &= legal_destinations(slider_location, masks) & target_mask;
     attacks = quiet_moves & opponent_no_king;
     quiet_moves &= ~(my_pieces | attacks);
 
     while (attacks)
     {
-      target_location = bitscan(attacks);
-      moves->push_back(encode_move(queen_location, target_location, white, QUEEN, NO_PIECE, true, false, false, false));
-      attacks = set_bit_low(attacks, target_location);
+      target_location = pop_lsb(attacks);
+      moves->push_back(
+          encode_move(slider_location, target_location, Us == WHITE, Piece, NO_PIECE, true, false, false, false));
     }
 
     while (quiet_moves)
     {
-      target_location = bitscan(quiet_moves);
+      target_location = pop_lsb(quiet_moves);
       moves->push_back(
-          encode_move(queen_location, target_location, white, QUEEN, NO_PIECE, false, false, false, false));
-      quiet_moves = set_bit_low(quiet_moves, target_location);
+          encode_move(slider_location, target_location, Us == WHITE, Piece, NO_PIECE, false, false, false, false));
     }
-
-    queens = set_bit_low(queens, queen_location);
   }
 }
 
-void castling_moves(Position* position, std::vector<uint32_t>* moves)
+template <Color Us>
+void generate_castling_moves(Position* position, MoveList* moves, uint64_t attacked)
 {
-  if (position->white_to_move)
+  constexpr bool white = Us == WHITE;
+  constexpr int king_square = white ? e1 : e8;
+  constexpr uint64_t kingside_path = white ? WHITE_KINGSIDE_CASTLE_MASK : BLACK_KINGSIDE_CASTLE_MASK;
+  constexpr uint64_t queenside_path = white ? WHITE_QUEENSIDE_CASTLE_MASK : BLACK_QUEENSIDE_CASTLE_MASK;
+
+  bool can_castle_kingside = white ? position->white_can_castle_kingside : position->black_can_castle_kingside;
+  bool can_castle_queenside = white ? position->white_can_castle_queenside : position->black_can_castle_queenside;
+  uint64_t rooks = pieces_of<Us>(position) & position->rooks;
+
+  // The king may not start, pass through or land on an attacked square
+  constexpr uint64_t kingside_king_path = 7ull << king_square;
+  constexpr uint64_t queenside_king_path = 7ull << (king_square - 2);
+
+  if (can_castle_kingside && !(attacked & kingside_king_path) && (all_occupied(position) & kingside_path) == 0 &&
+      (rooks & int_location_to_bitboard(king_square + 3)))
   {
-    if (position->white_can_castle_kingside && !is_square_attacked(position->white_to_move, e1, position) &&
-        !is_square_attacked(position->white_to_move, f1, position) &&
-        !is_square_attacked(position->white_to_move, g1, position) &&
-        (all_occupied(position) & WHITE_KINGSIDE_CASTLE_MASK) == 0 &&
-        (white_rooks(position) & int_location_to_bitboard(h1)))
-    {
-      moves->push_back(encode_move(e1, g1, true, KING, NO_PIECE, false, false, false, true));
-    }
-    if (position->white_can_castle_queenside && !is_square_attacked(position->white_to_move, c1, position) &&
-        !is_square_attacked(position->white_to_move, d1, position) &&
-        !is_square_attacked(position->white_to_move, e1, position) &&
-        (all_occupied(position) & WHITE_QUEENSIDE_CASTLE_MASK) == 0 &&
-        (white_rooks(position) & int_location_to_bitboard(a1)))
-    {
-      moves->push_back(encode_move(e1, c1, true, KING, NO_PIECE, false, false, false, true));
-    }
+    moves->push_back(encode_move(king_square, king_square + 2, white, KING, NO_PIECE, false, false, false, true));
   }
-  else
+  if (can_castle_queenside && !(attacked & queenside_king_path) && (all_occupied(position) & queenside_path) == 0 &&
+      (rooks & int_location_to_bitboard(king_square - 4)))
   {
-    if (position->black_can_castle_kingside && !is_square_attacked(position->white_to_move, e8, position) &&
-        !is_square_attacked(position->white_to_move, f8, position) &&
-        !is_square_attacked(position->white_to_move, g8, position) &&
-        (all_occupied(position) & BLACK_KINGSIDE_CASTLE_MASK) == 0 &&
-        (black_rooks(position) & int_location_to_bitboard(h8)))
-    {
-      moves->push_back(encode_move(e8, g8, false, KING, NO_PIECE, false, false, false, true));
-    }
-    if (position->black_can_castle_queenside && !is_square_attacked(position->white_to_move, c8, position) &&
-        !is_square_attacked(position->white_to_move, d8, position) &&
-        !is_square_attacked(position->white_to_move, e8, position) &&
-        (all_occupied(position) & BLACK_QUEENSIDE_CASTLE_MASK) == 0 &&
-        (black_rooks(position) & int_location_to_bitboard(a8)))
-    {
-      moves->push_back(encode_move(e8, c8, false, KING, NO_PIECE, false, false, false, true));
-    }
+    moves->push_back(encode_move(king_square, king_square - 2, white, KING, NO_PIECE, false, false, false, true));
   }
 }
+
+template void generate_pawn_pushes<WHITE>(Position*, MoveList*, const LegalityMasks&, uint64_t);
+template void generate_pawn_pushes<BLACK>(Position*, MoveList*, const LegalityMasks&, uint64_t);
+template void generate_pawn_captures<WHITE>(Position*, MoveList*, const LegalityMasks&, uint64_t);
+template void generate_pawn_captures<BLACK>(Position*, MoveList*, const LegalityMasks&, uint64_t);
+template void generate_king_moves<WHITE>(Position*, MoveList*, uint64_t, uint64_t);
+template void generate_king_moves<BLACK>(Position*, MoveList*, uint64_t, uint64_t);
+template void generate_knight_moves<WHITE>(Position*, MoveList*, const LegalityMasks&, uint64_t);
+template void generate_knight_moves<BLACK>(Position*, MoveList*, const LegalityMasks&, uint64_t);
+template void generate_castling_moves<WHITE>(Position*, MoveList*, uint64_t);
+template void generate_castling_moves<BLACK>(Position*, MoveList*, uint64_t);
+template void generate_slider_moves<WHITE, BISHOP>(Position*, MoveList*, const LegalityMasks&, uint64_t);
+template void generate_slider_moves<BLACK, BISHOP>(Position*, MoveList*, const LegalityMasks&, uint64_t);
+template void generate_slider_moves<WHITE, ROOK>(Position*, MoveList*, const LegalityMasks&, uint64_t);
+template void generate_slider_moves<BLACK, ROOK>(Position*, MoveList*, const LegalityMasks&, uint64_t);
+template void generate_slider_moves<WHITE, QUEEN>(Position*, MoveList*, const LegalityMasks&, uint64_t);
+template void generate_slider_moves<BLACK, QUEEN>(Position*, MoveList*, const LegalityMasks&, uint64_t);
+template Position make_move<WHITE>(Position*, uint32_t);
+template Position make_move<BLACK>(Position*, uint32_t);
+template void do_move<WHITE>(Position*, uint32_t, StateInfo*);
+template void do_move<BLACK>(Position*, uint32_t, StateInfo*);
+template void undo_move<WHITE>(Position*, uint32_t, const StateInfo&);
+template void undo_move<BLACK>(Position*, uint32_t, const StateInfo&);
+template LegalityMasks legality_masks<WHITE>(Position*);
+template LegalityMasks legality_masks<BLACK>(Position*);
+template CheckInfo check_info<WHITE>(Position*);
+template CheckInfo check_info<BLACK>(Position*);
+template bool gives_check<WHITE>(Position*, const CheckInfo&, uint32_t);
+template bool gives_check<BLACK>(Position*, const CheckInfo&, uint32_t);
+template bool is_legal_move<WHITE>(Position*, uint32_t);
+template bool is_legal_move<BLACK>(Position*, uint32_t);
+template AttackMaps attack_maps<WHITE>(Position*, uint64_t);
+template AttackMaps attack_maps<BLACK>(Position*, uint64_t);
+template uint64_t king_danger<WHITE>(Position*);
+template uint64_t king_danger<BLACK>(Position*);
+template MoveList generate_moves<WHITE>(Position*, GenerationType);
+template MoveList generate_moves<BLACK>(Position*, GenerationType);
+template int count_legal_moves<WHITE>(Position*);
+template int count_legal_moves<BLACK>(Position*);
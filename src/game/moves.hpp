@@ -4,7 +4,6 @@
 #include <array>
 #include <cstdint>
 #include <map>
-#include <vector>
 
 #include "../util/global.hpp"
 #include "../util/magicbitboards.hpp"
@@ -26,17 +25,6 @@ using a uinsigned 32 bit number
 0100 0000 0000 0000 0000 0000 0000 0000   |   check (added in move validation)
 */
 
-enum PieceAsInt
-{
-  KNIGHT,
-  BISHOP,
-  ROOK,
-  QUEEN,
-  PAWN,
-  KING,
-  NO_PIECE,
-};
-
 PieceAsInt victim_on_square(Position* position, Square square);
 
 enum MoveMasksIndices
@@ -88,27 +76,170 @@ inline bool decode_enpassant(uint32_t move) { return move & move_masks[7]; }
 inline bool decode_castling(uint32_t move) { return move & move_masks[8]; }
 inline bool decode_check(uint32_t move) { return move & move_masks[9]; }
 
+// Same from/to/piece/flags, ignoring the side-to-move and check annotations
+inline bool same_move(uint32_t move1, uint32_t move2) { return !((move1 ^ move2) & ~(move_masks[2] | move_masks[9])); }
+
+// Upper bound on pseudo-legal moves in any reachable position (218 legal is the known maximum)
+constexpr int MAX_MOVES = 256;
+
+// Fixed-capacity move buffer that lives on the stack so generating moves never touches the heap
+struct MoveList
+{
+  std::array<uint32_t, MAX_MOVES> moves;
+  int count = 0;
+
+  void push_back(uint32_t move) { moves[count++] = move; }
+  void clear() { count = 0; }
+  int size() const { return count; }
+  bool empty() const { return count == 0; }
+
+  uint32_t& operator[](int index) { return moves[index]; }
+  uint32_t operator[](int index) const { return moves[index]; }
+
+  uint32_t* begin() { return moves.data(); }
+  uint32_t* end() { return moves.data() + count; }
+  const uint32_t* begin() const { return moves.data(); }
+  const uint32_t* end() const { return moves.data() + count; }
+};
+
+// Legality information computed once per position so generators can emit legal moves directly
+struct LegalityMasks
+{
+  int king_square;      // Square of the side to move's king
+  uint64_t checkers;    // Enemy pieces giving check
+  uint64_t pinned;      // Our pieces pinned against our king
+  uint64_t check_mask;  // Destinations that capture the checker or block the check (all squares when not in check)
+};
+
+// Every square one side attacks, by attacking piece type (PieceAsInt) and all together
+struct AttackMaps
+{
+  std::array<uint64_t, 6> by_piece;
+  uint64_t all;
+};
+
+// Everything needed to tell whether a move checks the opponent without making it, computed once per position
+struct CheckInfo
+{
+  int enemy_king_square;
+  std::array<uint64_t, 6> check_squares;  // Squares from which each piece type (PieceAsInt) attacks the enemy king
+  uint64_t discovered_check_candidates;   // Our pieces standing between one of our sliders and the enemy king
+};
+
+// Which moves a call to generate_moves produces
+enum GenerationType
+{
+  CAPTURES,      // Captures, en passant and all promotions
+  QUIETS,        // Non-capturing, non-promoting moves including castling
+  EVASIONS,      // Every legal move, when the side to move is in check
+  QUIET_CHECKS,  // Quiet moves that give check
+  ALL_LEGAL,     // Every legal move
+};
+
 bool is_square_attacked(bool white, int square, Position* position);
+bool is_in_check(Position* position);
+uint64_t attackers_to(int square, uint64_t occupancy, Position* position);
 uint64_t attacked_squares(bool white, Position* position);
+
+template <Color Us>
+AttackMaps attack_maps(Position* position, uint64_t occupancy);
+AttackMaps attack_maps(bool white, Position* position);
+template <Color Us>
+uint64_t king_danger(Position* position);
 uint32_t encode_move(int from_square, int to_square, bool whites_turn, int moved_peice, int promoted_to_piece,
                      bool capture, bool double_push, bool enpassant, bool castling);
-
-void white_quiet_pawn_moves(Position* position, std::vector<uint32_t>* moves);
-void white_pawn_attacks(Position* position, std::vector<uint32_t>* moves);
-void black_quiet_pawn_moves(Position* position, std::vector<uint32_t>* moves);
-void black_pawn_attacks(Position* position, std::vector<uint32_t>* moves);
-void white_knight_moves(Position* position, std::vector<uint32_t>* moves);
-void black_knight_moves(Position* position, std::vector<uint32_t>* moves);
-void white_king_moves(Position* position, std::vector<uint32_t>* moves);
-void black_king_moves(Position* position, std::vector<uint32_t>* moves);
-void bishop_moves(Position* position, std::vector<uint32_t>* moves);
-void queen_moves(Position* position, std::vector<uint32_t>* moves);
-void rook_moves(Position* position, std::vector<uint32_t>* moves);
-void castling_moves(Position* position, std::vector<uint32_t>* moves);
-std::vector<uint32_t> pseudolegal_possible_moves(Position* position);
 bool validate_move(Position* position, uint32_t move);
-std::vector<uint32_t> valid_moves_for_position(Position position);
 
+// Each of these has a version for a side to move fixed at compile time, instantiated for WHITE and BLACK in
+// moves.cpp, and one that dispatches on position->white_to_move for callers that do not know the side
+template <Color Us>
+LegalityMasks legality_masks(Position* position);
+LegalityMasks legality_masks(Position* position);
+template <Color Us>
+CheckInfo check_info(Position* position);
+CheckInfo check_info(Position* position);
+template <Color Us>
+bool gives_check(Position* position, const CheckInfo& info, uint32_t move);
+bool gives_check(Position* position, const CheckInfo& info, uint32_t move);
+// Whether a move from anywhere (TT, killers) is legal here, the check flag is ignored
+template <Color Us>
+bool is_legal_move(Position* position, uint32_t move);
+bool is_legal_move(Position* position, uint32_t move);
+template <Color Us>
+MoveList generate_moves(Position* position, GenerationType type);
+MoveList generate_moves(Position* position, GenerationType type);
+MoveList valid_moves_for_position(Position position);
+// How many legal moves generate_moves(ALL_LEGAL) would produce, counted from target masks without encoding them
+template <Color Us>
+int count_legal_moves(Position* position);
+int count_legal_moves(Position* position);
+
+// What do_move cannot recover from the move itself, saved so undo_move can restore the position exactly
+struct StateInfo
+{
+  uint64_t hash;
+  uint64_t en_passant_target;
+  short int half_move_clock;
+  uint8_t castling_rights;  // zobrist::castling_rights_index of the position before the move
+  PieceAsInt captured_piece;
+};
+
+// Copy-make, the position is left untouched and the position after the move is returned
+template <Color Us>
+Position make_move(Position* position, uint32_t move);
 Position make_move(Position* position, uint32_t move);
 
+// Make-unmake, the move is played in place and undo_move takes it back using the state do_move filled in
+template <Color Us>
+void do_move(Position* position, uint32_t move, StateInfo* state);
+void do_move(Position* position, uint32_t move, StateInfo* state);
+template <Color Us>
+void undo_move(Position* position, uint32_t move, const StateInfo& state);
+void undo_move(Position* position, uint32_t move, const StateInfo& state);
+
+// The position after a move for search and perft. Built with PHASE_MAKE_UNMAKE the move is played in place and taken
+// back when this goes out of scope, otherwise it is played on a copy and the parent is never touched.
+template <Color Us>
+class ChildPosition
+{
+public:
+#ifdef PHASE_MAKE_UNMAKE
+  ChildPosition(Position* parent, uint32_t move) : position_(parent), move_(move) { do_move<Us>(parent, move, &state_); }
+  ~ChildPosition() { undo_move<Us>(position_, move_, state_); }
+
+  Position* get() { return position_; }
+#else
+  ChildPosition(Position* parent, uint32_t move) : position_(make_move<Us>(parent, move)) {}
+
+  Position* get() { return &position_; }
+#endif
+
+  ChildPosition(const ChildPosition&) = delete;
+  ChildPosition& operator=(const ChildPosition&) = delete;
+
+private:
+#ifdef PHASE_MAKE_UNMAKE
+  Position* position_;
+  uint32_t move_;
+  StateInfo state_;
+#else
+  Position position_;
+#endif
+};
+
+// Per-piece generators, each appends the legal moves of one piece type landing on target_mask. King moves and castling
+// take the squares the opponent attacks with our king off the board, see king_danger.
+template <Color Us>
+void generate_pawn_pushes(Position* position, MoveList* moves, const LegalityMasks& masks, uint64_t target_mask);
+template <Color Us>
+void generate_pawn_captures(Position* position, MoveList* moves, const LegalityMasks& masks, uint64_t target_mask);
+template <Color Us>
+void generate_knight_moves(Position* position, MoveList* moves, const LegalityMasks& masks, uint64_t target_mask);
+template <Color Us>
+void generate_king_moves(Position* position, MoveList* moves, uint64_t attacked, uint64_t target_mask);
+template <Color Us, PieceAsInt Piece>
+void generate_slider_moves(Position* position, MoveList* moves, const LegalityMasks& masks, uint64_t target_mask);
+template <Color Us>
+void generate_castling_moves(Position* position, MoveList* moves, uint64_t attacked);
+
 #endif
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include <iostream>
+#include <string>
 
+#include "bench/bench.hpp"
 #include "book/book.hpp"
 #include "search/search.hpp"
 #include "uci/uci.hpp"
@@ -8,11 +10,25 @@
 #include "util/util.hpp"
 #include "util/zobrist.hpp"
 
-int main()
+int main(int argc, char* argv[])
 {
   zobrist::init();
   book::init();
 
+  // `Phase_run bench board [iterations]` times the board representation and exits
+  if (argc > 2 && std::string(argv[1]) == "bench" && std::string(argv[2]) == "board")
+  {
+    bench::run_board(argc > 3 ? std::stoi(argv[3]) : bench::DEFAULT_BOARD_BENCH_ITERATIONS);
+    return 0;
+  }
+
+  // `Phase_run bench [movetime_ms]` runs the benchmark and exits
+  if (argc > 1 && std::string(argv[1]) == "bench")
+  {
+    bench::run(argc > 2 ? std::stoi(argv[2]) : bench::DEFAULT_BENCH_MOVETIME_MS);
+    return 0;
+  }
+
   UCI uci = UCI();
   uci.start();
 
@@ -0,0 +1,299 @@
+#include "perft.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include "../game/moves.hpp"
+
+namespace perft
+{
+
+// Folds the depth into the key, so one position counted to several depths has an entry for each
+static inline uint64_t depth_key(uint64_t position_hash, int depth)
+{
+  return position_hash ^ (static_cast<uint64_t>(depth) * 0x9e3779b97f4a7c15ull);
+}
+
+HashTable::HashTable(size_t size_mb)
+{
+  // Round down to a power of 2 for fast indexing
+  size_t entries = 1;
+  while (entries * 2 * sizeof(Entry) <= size_mb * 1024 * 1024)
+  {
+    entries *= 2;
+  }
+
+  table_ = std::vector<Entry>(entries);
+  index_mask_ = entries - 1;
+}
+
+bool HashTable::probe(uint64_t position_hash, int depth, uint64_t* nodes) const
+{
+  uint64_t key = depth_key(position_hash, depth);
+  const Entry& entry = table_[key & index_mask_];
+  uint64_t stored_nodes = entry.nodes.load(std::memory_order_relaxed);
+
+  if ((entry.checked_key.load(std::memory_order_relaxed) ^ stored_nodes) != key)
+  {
+    return false;
+  }
+
+  *nodes = stored_nodes;
+  return true;
+}
+
+void HashTable::store(uint64_t position_hash, int depth, uint64_t nodes)
+{
+  uint64_t key = depth_key(position_hash, depth);
+  Entry& entry = table_[key & index_mask_];
+  entry.checked_key.store(key ^ nodes, std::memory_order_relaxed);
+  entry.nodes.store(nodes, std::memory_order_relaxed);
+}
+
+// Counting policies perft is instantiated with. NodeCount is the bare leaf counter, StatsCount classifies every leaf
+// move, so only a run that asks for stats pays for them.
+struct NodeCount
+{
+  using Counts = uint64_t;
+  static constexpr bool hashed = true;
+
+  template <Color Us>
+  static Counts leaves(Position* position)
+  {
+    return count_legal_moves<Us>(position);
+  }
+};
+
+struct StatsCount
+{
+  using Counts = PerftStats;
+  static constexpr bool hashed = false;
+
+  template <Color Us>
+  static Counts leaves(Position* position)
+  {
+    PerftStats stats;
+    for (uint32_t move : generate_moves<Us>(position, ALL_LEGAL))
+    {
+      stats.nodes++;
+      stats.captures += decode_capture(move);
+      stats.en_passants += decode_enpassant(move);
+      stats.castles += decode_castling(move);
+      stats.promotions += decode_promoted_to_piece(move) != NO_PIECE;
+      stats.double_pushes += decode_double_push(move);
+
+      if (decode_check(move))
+      {
+        ChildPosition<Us> child(position, move);
+        stats.checks++;
+        stats.checkmates += count_legal_moves<opposite(Us)>(child.get()) == 0;
+      }
+    }
+    return stats;
+  }
+};
+
+template <Color Us, typename Policy>
+static typename Policy::Counts perft(Position* position, int depth, HashTable* table)
+{
+  // Leaves only need counting, so the moves to them are never made. That is cheaper than a table probe too.
+  if (depth == 1)
+  {
+    return Policy::template leaves<Us>(position);
+  }
+
+  typename Policy::Counts counts{};
+  if constexpr (Policy::hashed)
+  {
+    if (table && table->probe(position->hash, depth, &counts))
+    {
+      return counts;
+    }
+  }
+
+  for (uint32_t move : generate_moves<Us>(position, ALL_LEGAL))
+  {
+    ChildPosition<Us> child(position, move);
+    counts += perft<opposite(Us), Policy>(child.get(), depth - 1, table);
+  }
+
+  if constexpr (Policy::hashed)
+  {
+    if (table)
+    {
+      table->store(position->hash, depth, counts);
+    }
+  }
+
+  return counts;
+}
+
+uint64_t count_nodes(Position* position, int depth, HashTable* table)
+{
+  if (depth <= 0)
+  {
+    return 1;
+  }
+
+  return position->white_to_move ? perft<WHITE, NodeCount>(position, depth, table)
+                                 : perft<BLACK, NodeCount>(position, depth, table);
+}
+
+PerftStats count_stats(Position* position, int depth)
+{
+  if (depth <= 0)
+  {
+    return {.nodes = 1};
+  }
+
+  return position->white_to_move ? perft<WHITE, StatsCount>(position, depth, nullptr)
+                                 : perft<BLACK, StatsCount>(position, depth, nullptr);
+}
+
+// A position below the root counted to the remaining depth, nodes are added to the root move it came from
+struct Subtree
+{
+  Position position = {};
+  int depth = 0;
+  int root_index = 0;
+  int estimated_size = 0;
+  PerftStats stats = {};
+};
+
+PerftResult run(Position* position, int depth, int threads, size_t hash_mb, bool collect_stats)
+{
+  PerftResult result;
+  if (depth <= 0)
+  {
+    result.nodes = 1;
+    result.stats.nodes = collect_stats;
+    return result;
+  }
+
+  threads = std::max(threads, 1);
+  MoveList root_moves = generate_moves(position, ALL_LEGAL);
+  bool split_replies = threads > 1 && depth >= 3 && root_moves.size() < threads * SUBTREES_PER_THREAD;
+
+  std::vector<Subtree> subtrees;
+  for (int i = 0; i < root_moves.size(); i++)
+  {
+    Position after = make_move(position, root_moves[i]);
+    result.divide.push_back({root_moves[i], 0});
+
+    if (!split_replies)
+    {
+      subtrees.push_back({after, depth - 1, i, count_legal_moves(&after)});
+      continue;
+    }
+    for (uint32_t reply : generate_moves(&after, ALL_LEGAL))
+    {
+      Position after_reply = make_move(&after, reply);
+      subtrees.push_back({after_reply, depth - 2, i, count_legal_moves(&after_reply)});
+    }
+  }
+
+  // Widest subtrees first so the last ones left to finish are small and no thread waits long on another
+  std::stable_sort(subtrees.begin(), subtrees.end(),
+                   [](const Subtree& a, const Subtree& b) { return a.estimated_size > b.estimated_size; });
+
+  std::unique_ptr<HashTable> table = hash_mb && !collect_stats ? std::make_unique<HashTable>(hash_mb) : nullptr;
+  std::atomic<size_t> next_subtree{0};
+  auto count_subtrees = [&]() {
+    for (size_t i = next_subtree.fetch_add(1); i < subtrees.size(); i = next_subtree.fetch_add(1))
+    {
+      Subtree& subtree = subtrees[i];
+      if (collect_stats)
+      {
+        subtree.stats = count_stats(&subtree.position, subtree.depth);
+      }
+      else
+      {
+        subtree.stats.nodes = count_nodes(&subtree.position, subtree.depth, table.get());
+      }
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (int i = 1; i < threads; i++)
+  {
+    workers.emplace_back(count_subtrees);
+  }
+  count_subtrees();
+  for (auto& worker : workers)
+  {
+    worker.join();
+  }
+
+  // Each subtree has its own slot, so the sums do not depend on which thread counted what
+  for (const Subtree& subtree : subtrees)
+  {
+    result.divide[subtree.root_index].nodes += subtree.stats.nodes;
+    result.nodes += subtree.stats.nodes;
+    if (collect_stats)
+    {
+      result.stats += subtree.stats;
+    }
+  }
+
+  // The subtrees of a depth 1 run are the leaves themselves, which only their parent can classify
+  if (collect_stats && depth == 1)
+  {
+    result.stats = count_stats(position, 1);
+  }
+
+  return result;
+}
+
+// Suite fields are padded on both sides of each ';' and may be separated by runs of spaces
+static std::vector<std::string> words(const std::string& field)
+{
+  std::vector<std::string> tokens;
+  std::stringstream stream(field);
+  for (std::string token; stream >> token;)
+  {
+    tokens.push_back(token);
+  }
+  return tokens;
+}
+
+SuiteEntry parse_epd_line(const std::string& line)
+{
+  SuiteEntry entry;
+  std::stringstream fields(line);
+  std::string field;
+
+  std::getline(fields, field, ';');
+  std::vector<std::string> fen_tokens = words(field);
+  if (fen_tokens.size() != 4 && fen_tokens.size() != 6)
+  {
+    throw std::invalid_argument("Expected a FEN before the first ';' in: " + line);
+  }
+  for (const std::string& token : fen_tokens)
+  {
+    entry.fen += token + " ";
+  }
+  entry.fen += fen_tokens.size() == 4 ? "0 1" : "";
+  entry.fen.erase(entry.fen.find_last_not_of(' ') + 1);
+
+  while (std::getline(fields, field, ';'))
+  {
+    std::vector<std::string> tokens = words(field);
+    if (tokens.empty())
+    {
+      continue;
+    }
+    if (tokens.size() != 2 || tokens[0].size() < 2 || tokens[0][0] != 'D')
+    {
+      throw std::invalid_argument("Expected ';D<depth> <nodes>' but found '" + field + "' in: " + line);
+    }
+    entry.expected.push_back({std::stoi(tokens[0].substr(1)), std::stoull(tokens[1])});
+  }
+
+  return entry;
+}
+
+}  // namespace perft
@@ -0,0 +1,108 @@
+#ifndef PERFT_H
+#define PERFT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../util/global.hpp"
+
+namespace perft
+{
+
+// Root moves are split into their replies when there are fewer than this many per thread
+constexpr int SUBTREES_PER_THREAD = 8;
+
+// Node counts of positions already counted to some depth. Threads share it without locks: each entry stores the key
+// xor the count next to the count, so an entry torn by two racing writes fails the key check and is a miss.
+class HashTable
+{
+public:
+  explicit HashTable(size_t size_mb);
+
+  // Whether position_hash was counted to depth, and if so its node count
+  bool probe(uint64_t position_hash, int depth, uint64_t* nodes) const;
+  void store(uint64_t position_hash, int depth, uint64_t nodes);
+
+private:
+  struct Entry
+  {
+    std::atomic<uint64_t> checked_key;
+    std::atomic<uint64_t> nodes;
+  };
+
+  std::vector<Entry> table_;
+  size_t index_mask_;
+};
+
+// Leaf count below one root move
+struct DivideEntry
+{
+  uint32_t move;
+  uint64_t nodes;
+};
+
+// What the moves into the leaves were. Checkmates are the checking leaves with no legal reply, stalemates are not
+// counted.
+struct PerftStats
+{
+  uint64_t nodes = 0;
+  uint64_t captures = 0;  // Including en passant
+  uint64_t en_passants = 0;
+  uint64_t castles = 0;
+  uint64_t promotions = 0;
+  uint64_t double_pushes = 0;
+  uint64_t checks = 0;
+  uint64_t checkmates = 0;
+
+  PerftStats& operator+=(const PerftStats& other)
+  {
+    nodes += other.nodes;
+    captures += other.captures;
+    en_passants += other.en_passants;
+    castles += other.castles;
+    promotions += other.promotions;
+    double_pushes += other.double_pushes;
+    checks += other.checks;
+    checkmates += other.checkmates;
+    return *this;
+  }
+};
+
+struct PerftResult
+{
+  uint64_t nodes = 0;
+  std::vector<DivideEntry> divide;  // One entry per root move in generation order, whatever the thread count
+  PerftStats stats;                 // Only filled in when run is asked to collect stats
+};
+
+// Leaves of the tree depth plies below position, counted on the calling thread. With a table, subtrees reached again
+// through a transposition are looked up instead of counted.
+uint64_t count_nodes(Position* position, int depth, HashTable* table = nullptr);
+
+// The same count with every leaf classified. Each leaf move is decoded and checking ones are played to look for mate,
+// which is why count_nodes does none of it. Never hashed.
+PerftStats count_stats(Position* position, int depth);
+
+// The same count spread over threads. Subtrees below each root move (or each reply, for a narrow root) go on a shared
+// queue and idle threads take the next one, results are summed per root move once all are done. A non-zero hash_mb
+// gives all threads one shared table of that size, unless stats are collected.
+PerftResult run(Position* position, int depth, int threads = 1, size_t hash_mb = 0, bool collect_stats = false);
+
+// One position of a perft suite and the node counts it is known to have
+struct SuiteEntry
+{
+  std::string fen;
+  std::vector<std::pair<int, uint64_t>> expected;  // (depth, nodes) in the order listed
+};
+
+// Reads a suite line of the form `<fen> ;D1 20 ;D2 400 ...`, the FEN may leave out its two move counters. Throws
+// std::invalid_argument when the line is not in that form.
+SuiteEntry parse_epd_line(const std::string& line);
+
+}  // namespace perft
+
+#endif
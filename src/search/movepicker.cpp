@@ -0,0 +1,281 @@
+#include "movepicker.hpp"
+
+#include <algorithm>
+
+// clang-format off
+// Indexed [attacker][victim] in PieceAsInt order: N, B, R, Q, P, K
+const std::array<std::array<int, 6>, 6> mvv_lva_table = {{
+  {24, 34, 44, 54, 14, 64,},
+	{23, 33, 43, 53, 13, 63,},
+	{22, 32, 42, 52, 12, 62,},
+	{21, 31, 41, 51, 11, 61,},
+	{25, 35, 45, 55, 15, 65,},
+	{20, 30, 40, 50, 10, 60,},
+}};
+// clang-format on
+
+// Score constants for move ordering
+constexpr int TT_MOVE_SCORE = 100000;
+constexpr int CAPTURE_BASE_SCORE = 20000;
+constexpr int KILLER_1_SCORE = 15000;
+constexpr int KILLER_2_SCORE = 14000;
+constexpr int CHECK_SCORE = 10000;
+
+// Piece values for exchange evaluation, indexed by PieceAsInt
+constexpr std::array<int, 7> see_piece_values = {320, 330, 500, 900, 100, 20000, 0};
+
+// Cheapest first, the order attackers join an exchange
+constexpr std::array<PieceAsInt, 6> see_attacker_order = {PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING};
+
+int_fast32_t mvv_lva_score(Position* position, uint32_t move)
+{
+  PieceAsInt attacker_piece_move = decode_moved_piece(move);
+  PieceAsInt victim_piece_move = victim_on_square(position, static_cast<Square>(decode_to_square(move)));
+
+  return mvv_lva_table[attacker_piece_move][victim_piece_move];
+}
+
+int_fast32_t score_move(Position* position, uint32_t move, uint32_t tt_move, const KillerMoves& killers,
+                        const HistoryTable& history, uint64_t* moves_scored)
+{
+  (*moves_scored)++;
+
+  // TT move gets highest priority
+  if (move == tt_move && tt_move != 0)
+  {
+    return TT_MOVE_SCORE;
+  }
+
+  if (!decode_capture(move))
+  {
+    // score 1st killer move
+    if (killers[0] == move)
+    {
+      return KILLER_1_SCORE;
+    }
+    // score 2nd killer move
+    else if (killers[1] == move)
+    {
+      return KILLER_2_SCORE;
+    }
+    else if (decode_check(move))
+    {
+      return CHECK_SCORE;
+    }
+    else
+    {
+      return history[decode_from_square(move)][decode_to_square(move)] / 1000;
+    }
+  }
+
+  return mvv_lva_score(position, move) + CAPTURE_BASE_SCORE;
+}
+
+int static_exchange_evaluation(Position* position, uint32_t move)
+{
+  std::array<int, 40> gain;
+  int depth = 0;
+  int to_sq = decode_to_square(move);
+  uint64_t occupancy = all_occupied(position) ^ int_location_to_bitboard(decode_from_square(move));
+  bool white_to_capture = !position->white_to_move;
+  PieceAsInt piece_on_square = decode_moved_piece(move);
+
+  if (decode_enpassant(move))
+  {
+    gain[0] = see_piece_values[PAWN];
+    occupancy ^= position->white_to_move ? int_location_to_bitboard(to_sq + 8) : int_location_to_bitboard(to_sq - 8);
+  }
+  else
+  {
+    gain[0] = see_piece_values[victim_on_square(position, static_cast<Square>(to_sq))];
+  }
+
+  while (true)
+  {
+    depth++;
+
+    // Speculative, assumes the piece now on the square gets taken back
+    gain[depth] = see_piece_values[piece_on_square] - gain[depth - 1];
+
+    // Recomputing from the reduced occupancy picks up sliders x-raying through the pieces already traded
+    uint64_t attackers = attackers_to(to_sq, occupancy, position) & occupancy &
+                         (white_to_capture ? position->white : position->black);
+    if (!attackers)
+    {
+      break;
+    }
+
+    const std::array<uint64_t, 6> piece_bitboards = {position->knights, position->bishops, position->rooks,
+                                                     position->queens,  position->pawns,   position->kings};
+    for (PieceAsInt piece : see_attacker_order)
+    {
+      uint64_t candidates = attackers & piece_bitboards[piece];
+      if (candidates)
+      {
+        occupancy ^= candidates & -candidates;
+        piece_on_square = piece;
+        break;
+      }
+    }
+
+    white_to_capture = !white_to_capture;
+  }
+
+  // Either side may stop capturing whenever continuing would lose material
+  while (--depth)
+  {
+    gain[depth - 1] = -std::max(-gain[depth - 1], gain[depth]);
+  }
+
+  return gain[0];
+}
+
+MovePicker::MovePicker(Position* position, uint32_t tt_move, const KillerMoves& killers, const HistoryTable& history,
+                       uint64_t* moves_scored)
+    : position_(position),
+      history_(history),
+      moves_scored_(moves_scored),
+      tt_move_(tt_move),
+      killers_(killers),
+      stage_(TT_MOVE),
+      index_(0),
+      in_check_(is_in_check(position)),
+      check_info_ready_(false)
+{
+}
+
+uint32_t MovePicker::with_check_flag(uint32_t move)
+{
+  if (!check_info_ready_)
+  {
+    check_info_ = check_info(position_);
+    check_info_ready_ = true;
+  }
+
+  move &= ~move_masks[9];
+  return gives_check(position_, check_info_, move) ? move | move_masks[9] : move;
+}
+
+bool MovePicker::already_returned(uint32_t move) const
+{
+  return (tt_move_ && same_move(move, tt_move_)) || (killers_[0] && same_move(move, killers_[0])) ||
+         (killers_[1] && same_move(move, killers_[1]));
+}
+
+void MovePicker::score_generated(GenerationType type)
+{
+  moves_.count = 0;
+  index_ = 0;
+  for (uint32_t move : generate_moves(position_, type))
+  {
+    moves_.push_back(move, score_move(position_, move, 0, {}, history_, moves_scored_));
+  }
+}
+
+uint32_t MovePicker::next_move()
+{
+  switch (stage_)
+  {
+    case TT_MOVE:
+      stage_ = in_check_ ? GENERATE_EVASIONS : GENERATE_CAPTURES;
+      // The TT entry may belong to a different position sharing the index, so the move has to be checked
+      if (tt_move_ && is_legal_move(position_, tt_move_))
+      {
+        return with_check_flag(tt_move_);
+      }
+      tt_move_ = 0;
+      return next_move();
+
+    case GENERATE_CAPTURES:
+      score_generated(CAPTURES);
+      stage_ = WINNING_CAPTURES;
+      [[fallthrough]];
+
+    case WINNING_CAPTURES:
+      while (index_ < moves_.size())
+      {
+        uint32_t move = moves_.pick_best(index_++);
+        if (tt_move_ && same_move(move, tt_move_))
+        {
+          continue;
+        }
+        if (decode_capture(move) && static_exchange_evaluation(position_, move) < 0)
+        {
+          losing_captures_.push_back(move);
+          continue;
+        }
+        return move;
+      }
+
+      stage_ = KILLERS;
+      index_ = 0;
+      [[fallthrough]];
+
+    case KILLERS:
+      while (index_ < 2)
+      {
+        uint32_t& killer = killers_[index_++];
+        // Killers come from sibling nodes, so they are only tried when they are a legal quiet move here
+        if (killer && !decode_capture(killer) && decode_promoted_to_piece(killer) == NO_PIECE &&
+            !(tt_move_ && same_move(killer, tt_move_)) && !(index_ == 2 && same_move(killer, killers_[0])) &&
+            is_legal_move(position_, killer))
+        {
+          killer = with_check_flag(killer);
+          return killer;
+        }
+        killer = 0;
+      }
+
+      stage_ = GENERATE_QUIETS;
+      [[fallthrough]];
+
+    case GENERATE_QUIETS:
+      score_generated(QUIETS);
+      stage_ = QUIET_MOVES;
+      [[fallthrough]];
+
+    case QUIET_MOVES:
+      while (index_ < moves_.size())
+      {
+        uint32_t move = moves_.pick_best(index_++);
+        if (!already_returned(move))
+        {
+          return move;
+        }
+      }
+
+      stage_ = LOSING_CAPTURES;
+      index_ = 0;
+      [[fallthrough]];
+
+    case LOSING_CAPTURES:
+      if (index_ < losing_captures_.size())
+      {
+        return losing_captures_[index_++];
+      }
+      break;
+
+    case GENERATE_EVASIONS:
+      // In check there are few legal moves, they are all generated and ordered together
+      score_generated(EVASIONS);
+      stage_ = EVASION_MOVES;
+      [[fallthrough]];
+
+    case EVASION_MOVES:
+      while (index_ < moves_.size())
+      {
+        uint32_t move = moves_.pick_best(index_++);
+        if (!(tt_move_ && same_move(move, tt_move_)))
+        {
+          return move;
+        }
+      }
+      break;
+
+    case DONE:
+      break;
+  }
+
+  stage_ = DONE;
+  return 0;
+}
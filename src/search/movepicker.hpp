@@ -0,0 +1,113 @@
+#ifndef MOVEPICKER_H
+#define MOVEPICKER_H
+
+#include <array>
+#include <cstdint>
+#include <utility>
+
+#include "../game/moves.hpp"
+#include "../util/global.hpp"
+
+using KillerMoves = std::array<uint32_t, 2>;
+using HistoryTable = std::array<std::array<int_fast32_t, 64>, 64>;
+
+// A move paired with its ordering score, computed once when the move is added
+struct ScoredMove
+{
+  uint32_t move;
+  int_fast32_t score;
+};
+
+// Move buffer ordered lazily, each pick_best() is one step of a selection sort so a cutoff after the first few moves
+// never pays for ordering the rest
+struct ScoredMoveList
+{
+  std::array<ScoredMove, MAX_MOVES> moves;
+  int count = 0;
+
+  void push_back(uint32_t move, int_fast32_t score) { moves[count++] = {move, score}; }
+  int size() const { return count; }
+  bool empty() const { return count == 0; }
+
+  ScoredMove* begin() { return moves.data(); }
+  ScoredMove* end() { return moves.data() + count; }
+
+  // Swaps the best scored move among those from index on into index and returns it
+  uint32_t pick_best(int index)
+  {
+    int best = index;
+    for (int i = index + 1; i < count; i++)
+    {
+      if (moves[i].score > moves[best].score)
+      {
+        best = i;
+      }
+    }
+    std::swap(moves[index], moves[best]);
+    return moves[index].move;
+  }
+};
+
+// Ordering score of a capture, most valuable victim first and least valuable attacker breaking ties
+int_fast32_t mvv_lva_score(Position* position, uint32_t move);
+
+// Ordering score of any move: TT move, captures, killers, checks, then history. Each call adds one to moves_scored,
+// which the bench reports as the cost of move ordering.
+int_fast32_t score_move(Position* position, uint32_t move, uint32_t tt_move, const KillerMoves& killers,
+                        const HistoryTable& history, uint64_t* moves_scored);
+
+// Material balance of the capture sequence on the move's target square, from the mover's point of view
+int static_exchange_evaluation(Position* position, uint32_t move);
+
+// Hands out the moves of a position one at a time in search order, doing each stage's work only once it is reached
+//
+//   TT move -> winning captures and promotions -> killers -> quiet moves -> losing captures
+//   TT move -> evasions (when in check)
+//
+// A node that cuts off on the TT move never generates moves at all, one that cuts off on a capture never generates
+// the quiet moves.
+class MovePicker
+{
+public:
+  MovePicker(Position* position, uint32_t tt_move, const KillerMoves& killers, const HistoryTable& history,
+             uint64_t* moves_scored);
+
+  // Next legal move with its check flag set, or 0 once every move has been returned
+  uint32_t next_move();
+
+private:
+  enum Stage
+  {
+    TT_MOVE,
+    GENERATE_CAPTURES,
+    WINNING_CAPTURES,
+    KILLERS,
+    GENERATE_QUIETS,
+    QUIET_MOVES,
+    LOSING_CAPTURES,
+    GENERATE_EVASIONS,
+    EVASION_MOVES,
+    DONE,
+  };
+
+  void score_generated(GenerationType type);
+  uint32_t with_check_flag(uint32_t move);
+  bool already_returned(uint32_t move) const;
+
+  Position* position_;
+  const HistoryTable& history_;
+  uint64_t* moves_scored_;
+  uint32_t tt_move_;
+  KillerMoves killers_;
+  Stage stage_;
+  int index_;
+  bool in_check_;
+
+  CheckInfo check_info_;
+  bool check_info_ready_;
+
+  ScoredMoveList moves_;
+  MoveList losing_captures_;
+};
+
+#endif
@@ -3,13 +3,18 @@
 #include <algorithm>
 #include <atomic>
 #include <cmath>
+#include <condition_variable>
 #include <iostream>
 #include <limits>
+#include <memory>
+#include <mutex>
 #include <ranges>
+#include <string>
 
 #include "../evaluator/evaluator.hpp"
 #include "../game/moves.hpp"
 #include "../util/zobrist.hpp"
+#include "movepicker.hpp"
 #include "transposition.hpp"
 
 // Score constants
@@ -22,13 +27,9 @@ constexpr int CONTEMPT_THRESHOLD = 150;  // Score threshold for contempt
 constexpr int CONTEMPT_VALUE = 20;       // Base contempt value
 
 // Depth limits
-constexpr int MAX_KILLER_HISTORY_DEPTH = 100;
 constexpr int MAX_QUIESCENCE_DEPTH = 8;
 constexpr int MAX_SEARCH_DEPTH = 64;
 
-// Default time limit (overridden by time management)
-constexpr int DEFAULT_SEARCH_TIME_MS = 10000;
-
 // Mate score bounds (for TT storage)
 constexpr int MATE_BOUND = MATE_SCORE - MAX_SEARCH_DEPTH;
 
@@ -38,30 +39,11 @@ constexpr int MATE_BOUND = MATE_SCORE - MAX_SEARCH_DEPTH;
 #define THEIR_BEST_MOVE_START_VAL INFINITY_SCORE
 #define MY_BEST_MOVE_START_VAL (-INFINITY_SCORE)
 
-// clang-format off
-// Attacker K->B->R->Q->K->P (left to right)
-// Victim -> same (top to bottom)
-const std::array<std::array<int, 6>, 6> mvv_lva_table = {{
-  {24, 34, 44, 54, 64, 14,},
-	{23, 33, 43, 53, 63, 13,},
-	{22, 32, 42, 52, 62, 12,},
-	{21, 31, 41, 51, 61, 11,},
-	{20, 30, 40, 50, 60, 10,},
-	{25, 35, 45, 55, 65, 15,},
-}};
-// clang-format on
-
-// Thread-local search data
-thread_local std::array<std::array<uint32_t, 2>, MAX_KILLER_HISTORY_DEPTH> killer_moves = {};
-thread_local std::array<std::array<int_fast32_t, 64>, 64> history = {};
-thread_local std::vector<uint64_t> search_stack;
-
 // Global search context for game history and draw detection
 SearchContext search_context;
 
 // Thread count for Lazy SMP
 static int num_threads = 1;
-static std::atomic<uint64_t> total_nodes{0};
 
 // Calculate draw score with contempt based on root evaluation
 static int get_draw_score()
@@ -82,92 +64,82 @@ static int get_draw_score()
   return DRAW_SCORE;
 }
 
-// Check for repetition (2-fold in search, 3-fold with game history)
-static bool is_repetition(uint64_t hash)
+// Check for repetition (2-fold in search, 3-fold with game history). Only positions since the last irreversible move
+// can repeat, and only those with the same side to move, so the scan steps back two plies at a time from four plies
+// back to the half move clock.
+static bool is_repetition(SearchWorker* worker, const Position* position, int ply)
 {
-  // Check in search stack (2-fold repetition during search is a draw)
-  int count = 0;
-  for (auto it = search_stack.rbegin(); it != search_stack.rend(); ++it)
+  int end = std::min<int>(position->half_move_clock, worker->key_count);
+  bool seen_before_root = false;
+  for (int distance = 4; distance <= end; distance += 2)
   {
-    if (*it == hash)
+    if (worker->key_back(distance) == position->hash)
     {
-      count++;
-      if (count >= 1)
-        return true;  // Found same position once before in search = 2-fold
-    }
-  }
-
-  // Check in game history (need 2 occurrences for 3-fold total)
-  for (uint64_t h : search_context.game_history)
-  {
-    if (h == hash)
-    {
-      count++;
-      if (count >= 2)
-        return true;  // 3-fold repetition with game history
+      // Once during the search is a draw, a position from before the root must have been seen twice already
+      if (distance < ply || seen_before_root)
+        return true;
+      seen_before_root = true;
     }
   }
 
   return false;
 }
 
-// Score constants for move ordering
-constexpr int TT_MOVE_SCORE = 100000;
-constexpr int CAPTURE_BASE_SCORE = 20000;
-constexpr int KILLER_1_SCORE = 15000;
-constexpr int KILLER_2_SCORE = 14000;
-constexpr int CHECK_SCORE = 10000;
-
-int_fast32_t score_move(Position* position, uint32_t move, int depth, uint32_t tt_move)
+// Whether the side to move has a reversible move back to a position already on the search path, which the search
+// would find a draw a ply later. The opponent's moves since that position must cancel out, which is checked with
+// their keys, then the remaining difference must be a single reversible move whose path is clear.
+static bool has_upcoming_repetition(SearchWorker* worker, const Position* position, int ply)
 {
-  // TT move gets highest priority
-  if (move == tt_move && tt_move != 0)
-  {
-    return TT_MOVE_SCORE;
-  }
+  int end = std::min<int>(position->half_move_clock, worker->key_count);
+  if (end < 3)
+    return false;
 
-  if (!decode_capture(move))
+  uint64_t occupancy = position->white | position->black;
+  uint64_t their_moves = position->hash ^ worker->key_back(1) ^ zobrist::side_key;
+  for (int distance = 3; distance <= end && distance < ply; distance += 2)
   {
-    // score 1st killer move
-    if (depth < MAX_KILLER_HISTORY_DEPTH && killer_moves[depth][0] == move)
-    {
-      return KILLER_1_SCORE;
-    }
-    // score 2nd killer move
-    else if (depth < MAX_KILLER_HISTORY_DEPTH && killer_moves[depth][1] == move)
-    {
-      return KILLER_2_SCORE;
-    }
-    else if (decode_check(move))
-    {
-      return CHECK_SCORE;
-    }
-    else
-    {
-      return history[decode_from_square(move)][decode_to_square(move)] / 1000;
-    }
+    their_moves ^= worker->key_back(distance - 1) ^ worker->key_back(distance) ^ zobrist::side_key;
+    if (their_moves)
+      continue;
+
+    const zobrist::ReversibleMove* move = zobrist::find_reversible_move(position->hash ^ worker->key_back(distance));
+    if (!move)
+      continue;
+
+    // Knights and kings always get there, sliders only when the squares between are empty
+    uint64_t reach = move->piece == BISHOP  ? bishop_attacks(occupancy, move->from)
+                     : move->piece == ROOK  ? rook_attacks(occupancy, move->from)
+                     : move->piece == QUEEN ? queen_attacks(occupancy, move->from)
+                                            : ~0ull;
+    if (reach & int_location_to_bitboard(move->to))
+      return true;
   }
 
-  PieceAsInt attacker_piece_move = decode_moved_piece(move);
-  PieceAsInt victim_piece_move = victim_on_square(position, static_cast<Square>(decode_to_square(move)));
-
-  return mvv_lva_table[attacker_piece_move][victim_piece_move] + CAPTURE_BASE_SCORE;
+  return false;
 }
 
-bool compare_move_pair(Position* position, uint32_t move1, uint32_t move2, int depth, uint32_t tt_move)
+// Killer slots for a remaining depth, depths past the table have none
+static const KillerMoves& killers_at(SearchWorker* worker, int depth)
 {
-  int_fast32_t score1 = score_move(position, move1, depth, tt_move);
-  int_fast32_t score2 = score_move(position, move2, depth, tt_move);
-
-  return score1 > score2;
+  static const KillerMoves no_killers = {};
+  return depth < MAX_KILLER_HISTORY_DEPTH ? worker->killer_moves[depth] : no_killers;
 }
 
-std::vector<uint32_t> inline ordered_moves_for_search(Position* position, int depth, uint32_t tt_move = 0)
+// Root moves are all searched every iteration, so they are scored once and fully ordered
+MoveList inline ordered_moves_for_search(SearchWorker* worker, Position* position, int depth, uint32_t tt_move = 0)
 {
-  std::vector<uint32_t> moves = valid_moves_for_position(*position);
-  std::sort(moves.begin(), moves.end(),
-            [position, depth, tt_move](uint32_t move1, uint32_t move2)
-            { return compare_move_pair(position, move1, move2, depth, tt_move); });
+  ScoredMoveList scored_moves;
+  for (uint32_t move : valid_moves_for_position(*position))
+  {
+    scored_moves.push_back(
+        move, score_move(position, move, tt_move, killers_at(worker, depth), worker->history, &worker->moves_scored));
+  }
+
+  MoveList moves;
+  for (int i = 0; i < scored_moves.size(); i++)
+  {
+    moves.push_back(scored_moves.pick_best(i));
+  }
   return moves;
 }
 
@@ -192,19 +164,28 @@ uint32_t find_move_and_display_statistics(Position* position)
   return fmrv.best_move;
 }
 
+// Totals over every worker of the current search, summed on demand by the main thread
+static uint64_t nodes_searched();
+static uint64_t moves_scored_by_workers();
+
 // Global search state
 static std::chrono::high_resolution_clock::time_point search_start_time;
-static int search_time_limit_ms = DEFAULT_SEARCH_TIME_MS;
-static std::atomic<bool> search_stopped{false};
+static SearchLimits search_limits;
+alignas(CACHE_LINE_SIZE) static std::atomic<bool> search_stopped{false};  // Read at every node
+static std::chrono::microseconds first_info_latency{-1};  // Negative until the main thread prints an info line
+static int multi_pv = 1;
+static std::vector<SearchLine> main_lines;  // Written by the main thread only, read by it when reporting
 
 // Public functions to control search
-void set_search_time_limit(int time_ms) { search_time_limit_ms = time_ms; }
+void set_search_limits(const SearchLimits& limits) { search_limits = limits; }
 
-void stop_search() { search_stopped.store(true, std::memory_order_relaxed); }
+void set_search_time_limit(int time_ms) { set_search_limits({.time_ms = time_ms}); }
 
-void set_thread_count(int threads) { num_threads = std::max(1, std::min(threads, 64)); }
+void set_multi_pv(int lines) { multi_pv = std::max(1, std::min(lines, MAX_MULTI_PV)); }
 
-int get_thread_count() { return num_threads; }
+int get_multi_pv() { return multi_pv; }
+
+void stop_search() { search_stopped.store(true, std::memory_order_relaxed); }
 
 // Check if we should stop searching
 static bool should_stop()
@@ -214,45 +195,209 @@ static bool should_stop()
 
   auto now = std::chrono::high_resolution_clock::now();
   auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - search_start_time);
-  return elapsed.count() > search_time_limit_ms;
+  return elapsed.count() > search_limits.time_ms;
 }
 
-find_move_return_val find_move_with_history(Position* position, const std::vector<uint64_t>& history)
+// Checked on entering every node. The stop flag and node budget are cheap enough to test each time, the clock is only
+// read every 4096 nodes. A node budget stops the search on the exact node with one thread, with several the total is
+// only summed every 1024 nodes.
+static bool should_stop_at_node(SearchWorker* worker)
 {
-  search_context.game_history = history;
-  return find_move(position);
+  if (search_stopped.load(std::memory_order_relaxed))
+  {
+    return true;
+  }
+
+  uint64_t nodes = worker->nodes();
+  if (search_limits.nodes)
+  {
+    bool budget_spent = num_threads == 1 ? nodes >= search_limits.nodes
+                                         : (nodes & 1023) == 0 && nodes_searched() >= search_limits.nodes;
+    if (budget_spent)
+    {
+      stop_search();
+      return true;
+    }
+  }
+
+  return (nodes & 4095) == 0 && should_stop();
+}
+
+// Whether the main thread should begin another iteration. Past the optimum time it does not, as one it cannot finish
+// would be thrown away. The optimum is stretched while the best move keeps changing or shares the root's nodes with
+// other moves, and shrunk once it has held for several iterations and took most of them.
+static bool time_for_next_iteration(int stable_iterations, double best_move_node_fraction)
+{
+  if (!search_limits.optimum_ms)
+  {
+    return true;
+  }
+
+  double stability_scale = 1.4 - 0.1 * std::min(stable_iterations, 6);
+  double effort_scale = 1.6 - best_move_node_fraction;
+
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() -
+                                                                       search_start_time);
+  return elapsed.count() < search_limits.optimum_ms * stability_scale * effort_scale;
 }
 
 // Aspiration window parameters
 constexpr int ASP_WINDOW_INITIAL = 25;  // Initial window size (centipawns)
 constexpr int ASP_WINDOW_MIN_DEPTH = 4;  // Start using aspiration windows at this depth
 
-// Shared results for Lazy SMP
-static std::atomic<uint32_t> shared_best_move{0};
-static std::atomic<int_fast32_t> shared_best_score{0};
-static std::atomic<int> shared_best_depth{0};
+// Shared results for Lazy SMP, written whenever a thread completes a deeper iteration so kept on a line of their own
+struct alignas(CACHE_LINE_SIZE) SharedBest
+{
+  std::atomic<uint32_t> move{0};
+  std::atomic<int_fast32_t> score{0};
+  std::atomic<int> depth{0};
+
+  // The line behind move, set under the lock as it cannot be written atomically. Taken once per iteration at most.
+  std::mutex pv_mutex;
+  std::vector<uint32_t> pv;
+};
+static SharedBest shared_best;
+
+// The moves of a line as UCI prints them, separated by spaces
+static std::string pv_string(const std::vector<uint32_t>& pv)
+{
+  std::string line;
+  for (uint32_t move : pv)
+  {
+    if (!line.empty())
+      line += ' ';
+    line += uint_move_to_engine_string_move(move);
+  }
+  return line;
+}
+
+// Wakes the helper threads, the main thread does so after its first info line
+static void release_helpers();
+
+// Score as UCI prints it, in centipawns or as moves to mate
+static std::string score_string(int_fast32_t score)
+{
+  if (score >= MATE_BOUND)
+  {
+    return "mate " + std::to_string((MATE_SCORE - score + 1) / 2);
+  }
+  else if (score <= -MATE_BOUND)
+  {
+    return "mate " + std::to_string(-(MATE_SCORE + score + 1) / 2);
+  }
+  return "cp " + std::to_string(score);
+}
+
+// Searches the root moves that are not the first move of an excluded line, in an aspiration window around the score
+// the line had at the last depth, until the best of them scores inside the window. Returns false if the search was
+// stopped first. node_fraction is the share of the last pass's nodes spent below the line's move.
+static bool search_root_line(SearchWorker* worker, Position* position, int depth, uint32_t hint_move,
+                             const std::vector<SearchLine>& excluded, const SearchLine* previous, SearchLine* line,
+                             double* node_fraction)
+{
+  bool aspirate =
+      previous && depth >= ASP_WINDOW_MIN_DEPTH && previous->score > -MATE_BOUND && previous->score < MATE_BOUND;
+  int_fast32_t alpha = aspirate ? previous->score - ASP_WINDOW_INITIAL : MY_BEST_MOVE_START_VAL;
+  int_fast32_t beta = aspirate ? previous->score + ASP_WINDOW_INITIAL : THEIR_BEST_MOVE_START_VAL;
+  int asp_delta = ASP_WINDOW_INITIAL;
+
+  while (true)
+  {
+    if (should_stop())
+      return false;
+
+    int_fast32_t best_score = MY_BEST_MOVE_START_VAL;
+    uint32_t best_move = 0;
+    uint64_t best_move_nodes = 0;
+    uint64_t start_nodes = worker->nodes();
+    worker->pv.clear(0);
+
+    for (uint32_t move : ordered_moves_for_search(worker, position, depth, hint_move))
+    {
+      if (std::any_of(excluded.begin(), excluded.end(),
+                      [move](const SearchLine& other) { return same_move(other.move, move); }))
+        continue;
+
+      if (should_stop())
+        return false;
+
+      Position new_position = make_move(position, move);
+
+      uint64_t move_start_nodes = worker->nodes();
+      int_fast32_t score = -principal_variation_search(worker, &new_position, depth - 1, 1, -beta, -std::max(alpha, best_score));
+
+      if (score > best_score)
+      {
+        best_move = move;
+        best_score = score;
+        best_move_nodes = worker->nodes() - move_start_nodes;
+        worker->pv.update(0, move);
+      }
+    }
+
+    if (should_stop())
+      return false;
+
+    // Aspiration window re-search
+    if (aspirate)
+    {
+      if (best_score <= alpha)
+      {
+        asp_delta *= 2;
+        alpha = std::max(static_cast<int_fast32_t>(-INFINITY_SCORE), previous->score - asp_delta);
+        continue;
+      }
+      else if (best_score >= beta)
+      {
+        asp_delta *= 2;
+        beta = std::min(static_cast<int_fast32_t>(INFINITY_SCORE), previous->score + asp_delta);
+        continue;
+      }
+    }
+
+    uint64_t nodes = worker->nodes() - start_nodes;
+    *node_fraction = nodes ? static_cast<double>(best_move_nodes) / nodes : 0;
+    *line = {best_move, best_score, worker->pv.line(0)};
+    return true;
+  }
+}
 
 // Worker thread search function
-static void search_worker(Position position, int thread_id)
+static void search_worker(Position position, SearchWorker* worker)
 {
-  // Initialize thread-local data
-  search_stack.clear();
-  search_stack.reserve(MAX_SEARCH_DEPTH + 10);
+  int thread_id = worker->thread_id;
+
+  // Seed the key history with the game since its last irreversible move, ending with the root
+  const std::vector<uint64_t>& history = search_context.game_history;
+  size_t history_end = !history.empty() && history.back() == position.hash ? history.size() - 1 : history.size();
+  size_t history_kept = std::min<size_t>({history_end, static_cast<size_t>(position.half_move_clock),
+                                          static_cast<size_t>(KEY_HISTORY_SIZE - 1)});
+  worker->key_count = 0;
+  for (size_t i = history_end - history_kept; i < history_end; i++)
+  {
+    worker->push_key(history[i]);
+  }
+  worker->push_key(position.hash);
 
   // Age history (each thread has its own)
-  for (auto& row : history)
+  for (auto& row : worker->history)
   {
     for (auto& val : row)
     {
       val /= 2;
     }
   }
-  for (auto& km : killer_moves)
+  for (auto& km : worker->killer_moves)
     km.fill(0);
+  worker->moves_scored = 0;
 
-  uint32_t last_best_move = 0, current_best_move = 0;
-  int_fast32_t last_best_score = 0, current_best_score;
-  uint64_t nodes = 0;
+  uint32_t last_best_move = 0;
+  int stable_iterations = 0;  // Completed iterations in a row that kept the best move
+  double best_move_node_fraction = 0;  // Share of the last iteration's root nodes spent below its best move
+
+  // Only the main thread reports, so only it searches more than one line. Helpers fill the TT searching the best.
+  int line_count = std::min(thread_id == 0 ? multi_pv : 1, valid_moves_for_position(position).size());
+  std::vector<SearchLine> lines;  // The last completed iteration's, best first
 
   // Get TT move hint for root
   uint32_t tt_move = TT.probe_move(position.hash);
@@ -260,199 +405,379 @@ static void search_worker(Position position, int thread_id)
   // Start at different depths to diversify search (Lazy SMP technique)
   int start_depth = 1 + (thread_id % 2);
 
-  for (int depth = start_depth; depth <= MAX_SEARCH_DEPTH; depth++)
+  int max_depth = search_limits.depth ? std::min(search_limits.depth, MAX_SEARCH_DEPTH) : MAX_SEARCH_DEPTH;
+  for (int depth = start_depth; depth <= max_depth && line_count > 0; depth++)
   {
     if (should_stop())
       break;
 
-    int_fast32_t alpha = MY_BEST_MOVE_START_VAL;
-    int_fast32_t beta = THEIR_BEST_MOVE_START_VAL;
-
-    if (depth >= ASP_WINDOW_MIN_DEPTH && last_best_score > -MATE_BOUND && last_best_score < MATE_BOUND)
+    // Each line starts from the move it had at the last depth, the first from the TT move before there is one
+    std::vector<SearchLine> depth_lines;
+    for (int k = 0; k < line_count; k++)
     {
-      alpha = last_best_score - ASP_WINDOW_INITIAL;
-      beta = last_best_score + ASP_WINDOW_INITIAL;
+      const SearchLine* previous = k < static_cast<int>(lines.size()) ? &lines[k] : nullptr;
+      uint32_t hint_move = previous ? previous->move : (k == 0 ? tt_move : 0);
+      SearchLine line;
+      double node_fraction;
+      if (!search_root_line(worker, &position, depth, hint_move, depth_lines, previous, &line, &node_fraction))
+        break;
+
+      if (k == 0)
+        best_move_node_fraction = node_fraction;
+      depth_lines.push_back(line);
     }
 
-    int asp_delta = ASP_WINDOW_INITIAL;
+    if (static_cast<int>(depth_lines.size()) < line_count)
+      break;
 
-    while (true)
+    // A line searched without the moves above it can still come out ahead of them through its aspiration window
+    std::stable_sort(depth_lines.begin(), depth_lines.end(),
+                     [](const SearchLine& a, const SearchLine& b) { return a.score > b.score; });
+    lines = depth_lines;
+    const SearchLine& best = lines[0];
+
+    // Update shared best if this thread found a better result
+    int current_shared_depth = shared_best.depth.load(std::memory_order_relaxed);
+    if (depth > current_shared_depth)
     {
-      if (should_stop())
-        break;
+      std::lock_guard<std::mutex> lock(shared_best.pv_mutex);
+      shared_best.move.store(best.move, std::memory_order_relaxed);
+      shared_best.score.store(best.score, std::memory_order_relaxed);
+      shared_best.depth.store(depth, std::memory_order_relaxed);
+      shared_best.pv = best.pv;
+    }
 
-      current_best_score = MY_BEST_MOVE_START_VAL;
-      int_fast32_t current_score = 0;
-      uint32_t depth_best_move = 0;
+    // Output info from thread 0 only
+    if (thread_id == 0)
+    {
+      main_lines = lines;
 
-      std::vector<uint32_t> moves = ordered_moves_for_search(&position, depth, tt_move);
+      auto now = std::chrono::high_resolution_clock::now();
+      auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - search_start_time);
+      bool first_info = first_info_latency.count() < 0;
+      if (first_info)
+      {
+        first_info_latency = std::chrono::duration_cast<std::chrono::microseconds>(now - search_start_time);
+      }
+      uint64_t total = nodes_searched();
+      float nps = total / ((elapsed.count() + 1.0f) / 1000.0f);
 
-      if (moves.empty())
-        break;
+      for (int k = 0; k < line_count; k++)
+      {
+        std::cout << "info depth " << depth << " seldepth " << depth;
+        if (multi_pv > 1)
+        {
+          std::cout << " multipv " << k + 1;
+        }
+        std::cout << " score " << score_string(lines[k].score) << " nodes " << total << " nps "
+                  << static_cast<int>(nps) << " time " << elapsed.count() << " hashfull " << TT.hashfull() << " pv "
+                  << pv_string(lines[k].pv) << std::endl;
+      }
 
-      for (uint32_t move : moves)
+      if (first_info)
       {
-        if (should_stop())
-          break;
+        release_helpers();
+      }
+    }
 
-        Position new_position = make_move(&position, move);
+    stable_iterations = best.move == last_best_move ? stable_iterations + 1 : 0;
+    last_best_move = best.move;
 
-        current_score = -principal_variation_search(&new_position, depth - 1, 1, -beta, -std::max(alpha, current_best_score), &nodes);
+    // Check for mate
+    if (best.score >= MATE_BOUND || best.score <= -MATE_BOUND)
+      break;
 
-        if (current_score > current_best_score)
-        {
-          current_best_move = move;
-          current_best_score = current_score;
-          depth_best_move = move;
-        }
+    // Helpers keep searching until the main thread stops them
+    if (thread_id == 0 && !time_for_next_iteration(stable_iterations, best_move_node_fraction))
+      break;
+  }
+}
+
+// Collects what the threads found once they have all stopped, and prints the final info line
+static find_move_return_val finish_search(Position* position)
+{
+  // Get results
+  uint32_t best_move = shared_best.move.load(std::memory_order_relaxed);
+
+  std::vector<uint32_t> pv = shared_best.pv;
+
+  // A search stopped before its first iteration completed still has to play something
+  if (best_move == 0)
+  {
+    MoveList moves = generate_moves(position, ALL_LEGAL);
+    best_move = moves.empty() ? 0 : moves[0];
+    pv = {best_move};
+  }
+
+  int_fast32_t best_score = shared_best.score.load(std::memory_order_relaxed);
+  int best_depth = shared_best.depth.load(std::memory_order_relaxed);
+  uint64_t nodes = nodes_searched();
+
+  auto end_time = std::chrono::high_resolution_clock::now();
+  auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - search_start_time);
+  if (first_info_latency.count() < 0)
+  {
+    first_info_latency = std::chrono::duration_cast<std::chrono::microseconds>(end_time - search_start_time);
+  }
+
+  // Output final info
+  float nps = nodes / ((duration.count() + 1.0f) / 1000.0f);
+  std::cout << "info depth " << best_depth << " seldepth " << best_depth << " score " << score_string(best_score);
+  std::cout << " nodes " << nodes << " nps " << static_cast<int>(nps) << " time " << duration.count() << " hashfull "
+            << TT.hashfull();
+  if (best_move != 0)
+  {
+    std::cout << " pv " << pv_string(pv);
+  }
+  std::cout << std::endl;
+
+  // Update root score for next search
+  search_context.root_score = best_score;
+
+  return {best_move, nodes, duration, best_depth, best_score, pv, moves_scored_by_workers(), first_info_latency,
+          main_lines};
+}
+
+// Lazy SMP threads, created when the thread count is set and parked on a condition variable between searches so a go
+// neither pays for thread creation nor starts from cold thread-local tables. Thread 0 is the main search thread: it
+// releases the helpers once it has printed its first info line, so waking them never delays that line, and once its
+// own search ends it stops the helpers, waits for them and reports the result.
+class SearchThreadPool
+{
+public:
+  ~SearchThreadPool() { resize(0); }
+
+  void resize(int threads)
+  {
+    wait();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      exiting_ = true;
+    }
+    wake_main_.notify_all();
+    wake_helpers_.notify_all();
+    for (std::thread& thread : threads_)
+    {
+      thread.join();
+    }
+
+    threads_.clear();
+    exiting_ = false;
+
+    // Workers that stay keep their tables, so a resize costs no more warm-up than the new threads need
+    workers_.resize(threads);
+    for (int i = 0; i < threads; i++)
+    {
+      if (!workers_[i])
+      {
+        workers_[i] = std::make_unique<SearchWorker>();
+        workers_[i]->thread_id = i;
       }
+      threads_.emplace_back(&SearchThreadPool::idle_loop, this, workers_[i].get(),
+                            i == 0 ? search_id_ : helper_search_id_);
+    }
+  }
 
-      if (should_stop())
-        break;
+  int size() const { return static_cast<int>(threads_.size()); }
+
+  // Totals over the workers. Nodes are read while the threads search and may trail slightly, moves scored are only
+  // filled in as each worker finishes.
+  uint64_t nodes() const
+  {
+    uint64_t total = 0;
+    for (const auto& worker : workers_)
+    {
+      total += worker->nodes();
+    }
+    return total;
+  }
+
+  uint64_t moves_scored() const
+  {
+    uint64_t total = 0;
+    for (const auto& worker : workers_)
+    {
+      total += worker->moves_scored;
+    }
+    return total;
+  }
 
-      // Aspiration window re-search
-      if (depth >= ASP_WINDOW_MIN_DEPTH && last_best_score > -MATE_BOUND && last_best_score < MATE_BOUND)
+  void start(const Position& position, std::function<void(const find_move_return_val&)> on_done)
+  {
+    wait();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      position_ = position;
+      on_done_ = std::move(on_done);
+      for (auto& worker : workers_)
       {
-        if (current_best_score <= alpha)
-        {
-          asp_delta *= 2;
-          alpha = std::max(static_cast<int_fast32_t>(-INFINITY_SCORE), last_best_score - asp_delta);
-          continue;
-        }
-        else if (current_best_score >= beta)
-        {
-          asp_delta *= 2;
-          beta = std::min(static_cast<int_fast32_t>(INFINITY_SCORE), last_best_score + asp_delta);
-          continue;
-        }
+        worker->clear_nodes();
+        worker->moves_scored = 0;
       }
+      helpers_running_ = 0;
+      searching_ = true;
+      search_id_++;
+    }
+    wake_main_.notify_one();
+  }
 
-      tt_move = depth_best_move;
-      break;
+  // Called by the main thread, only the first call of a search wakes the helpers
+  void release_helpers()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (helper_search_id_ == search_id_)
+      {
+        return;
+      }
+      helpers_running_ = size() - 1;
+      helper_search_id_ = search_id_;
     }
+    wake_helpers_.notify_all();
+  }
 
-    if (should_stop())
-      break;
+  void wait()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    finished_.wait(lock, [this] { return !searching_; });
+  }
 
-    // Update shared best if this thread found a better result
-    int current_shared_depth = shared_best_depth.load(std::memory_order_relaxed);
-    if (depth > current_shared_depth)
+  void clear_tables()
+  {
+    wait();
+    for (auto& worker : workers_)
     {
-      shared_best_move.store(current_best_move, std::memory_order_relaxed);
-      shared_best_score.store(current_best_score, std::memory_order_relaxed);
-      shared_best_depth.store(depth, std::memory_order_relaxed);
+      worker->history = {};
     }
+  }
 
-    // Accumulate nodes
-    total_nodes.fetch_add(nodes, std::memory_order_relaxed);
+  // Only read once wait has returned
+  find_move_return_val last_result = {};
 
-    // Output info from thread 0 only
-    if (thread_id == 0)
+private:
+  // search_id is the last search this thread has seen, a thread created mid-game must not rerun the previous one
+  void idle_loop(SearchWorker* worker, uint64_t search_id)
+  {
+    bool is_main = worker->thread_id == 0;
+    const uint64_t& next_search_id = is_main ? search_id_ : helper_search_id_;
+
+    while (true)
     {
-      auto now = std::chrono::high_resolution_clock::now();
-      auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - search_start_time);
-      uint64_t total = total_nodes.load(std::memory_order_relaxed);
-      float nps = total / ((elapsed.count() + 1.0f) / 1000.0f);
+      Position position;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        (is_main ? wake_main_ : wake_helpers_).wait(lock, [&] { return exiting_ || next_search_id != search_id; });
+        if (exiting_)
+        {
+          return;
+        }
+        search_id = next_search_id;
+        position = position_;
+      }
+
+      search_worker(position, worker);
 
-      std::cout << "info depth " << depth << " seldepth " << depth << " score ";
-      if (current_best_score >= MATE_BOUND)
+      if (!is_main)
       {
-        int mate_in = (MATE_SCORE - current_best_score + 1) / 2;
-        std::cout << "mate " << mate_in;
+        std::lock_guard<std::mutex> lock(mutex_);
+        helpers_running_--;
+        finished_.notify_all();
+        continue;
       }
-      else if (current_best_score <= -MATE_BOUND)
+
+      // The helpers only feed the TT, there is nothing left for them to do once the main thread is done
+      stop_search();
       {
-        int mate_in = -(MATE_SCORE + current_best_score + 1) / 2;
-        std::cout << "mate " << mate_in;
+        std::unique_lock<std::mutex> lock(mutex_);
+        finished_.wait(lock, [this] { return helpers_running_ == 0; });
       }
-      else
+
+      last_result = finish_search(&position);
+      if (on_done_)
       {
-        std::cout << "cp " << current_best_score;
+        on_done_(last_result);
       }
-      std::cout << " nodes " << total << " nps " << static_cast<int>(nps) << " time " << elapsed.count() << " hashfull "
-                << TT.hashfull() << " pv " << uint_move_to_engine_string_move(current_best_move) << std::endl;
+
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        searching_ = false;
+      }
+      finished_.notify_all();
     }
+  }
 
-    nodes = 0;
-    last_best_move = current_best_move;
-    last_best_score = current_best_score;
+  std::vector<std::unique_ptr<SearchWorker>> workers_;
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable wake_main_;     // Signalled when a search starts or the threads should exit
+  std::condition_variable wake_helpers_;  // Signalled when the main thread releases the helpers or they should exit
+  std::condition_variable finished_;      // Signalled when a helper or the whole search finishes
+  uint64_t search_id_ = 0;
+  uint64_t helper_search_id_ = 0;  // The last search the helpers were released into
+  int helpers_running_ = 0;
+  bool searching_ = false;
+  bool exiting_ = false;
+  Position position_;
+  std::function<void(const find_move_return_val&)> on_done_;
+};
 
-    // Check for mate
-    if (current_best_score >= MATE_BOUND || current_best_score <= -MATE_BOUND)
-      break;
-  }
+static SearchThreadPool search_threads;
+
+static void release_helpers() { search_threads.release_helpers(); }
+
+static uint64_t nodes_searched() { return search_threads.nodes(); }
 
-  // Add remaining nodes
-  total_nodes.fetch_add(nodes, std::memory_order_relaxed);
+static uint64_t moves_scored_by_workers() { return search_threads.moves_scored(); }
+
+void set_thread_count(int threads)
+{
+  num_threads = std::max(1, std::min(threads, 64));
+  search_threads.resize(num_threads);
 }
 
-find_move_return_val find_move(Position* position)
+int get_thread_count() { return num_threads; }
+
+void start_search(const Position& position, std::function<void(const find_move_return_val&)> on_done)
 {
+  // The state below is shared with the threads of any search still running
+  search_threads.wait();
+
   // Reset search state
   search_start_time = std::chrono::high_resolution_clock::now();
   search_stopped.store(false, std::memory_order_relaxed);
-  total_nodes.store(0, std::memory_order_relaxed);
-  shared_best_move.store(0, std::memory_order_relaxed);
-  shared_best_score.store(0, std::memory_order_relaxed);
-  shared_best_depth.store(0, std::memory_order_relaxed);
+  first_info_latency = std::chrono::microseconds(-1);
+  shared_best.move.store(0, std::memory_order_relaxed);
+  shared_best.score.store(0, std::memory_order_relaxed);
+  shared_best.depth.store(0, std::memory_order_relaxed);
+  shared_best.pv.clear();
+  main_lines.clear();
 
   // Start new TT generation
   TT.new_search();
 
-  // Launch worker threads
-  std::vector<std::thread> threads;
-  for (int i = 1; i < num_threads; i++)
+  // The threads are only created here if no thread count was ever set
+  if (search_threads.size() != num_threads)
   {
-    threads.emplace_back(search_worker, *position, i);
-  }
-
-  // Main thread also searches (thread 0)
-  search_worker(*position, 0);
-
-  // Wait for all threads to finish
-  for (auto& t : threads)
-  {
-    t.join();
+    search_threads.resize(num_threads);
   }
+  search_threads.start(position, std::move(on_done));
+}
 
-  // Get results
-  uint32_t best_move = shared_best_move.load(std::memory_order_relaxed);
-  int_fast32_t best_score = shared_best_score.load(std::memory_order_relaxed);
-  int best_depth = shared_best_depth.load(std::memory_order_relaxed);
-  uint64_t nodes = total_nodes.load(std::memory_order_relaxed);
+void wait_for_search() { search_threads.wait(); }
 
-  auto end_time = std::chrono::high_resolution_clock::now();
-  auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - search_start_time);
+void clear_search_tables() { search_threads.clear_tables(); }
 
-  // Output final info
-  float nps = nodes / ((duration.count() + 1.0f) / 1000.0f);
-  std::cout << "info depth " << best_depth << " seldepth " << best_depth << " score ";
-  if (best_score >= MATE_BOUND)
-  {
-    int mate_in = (MATE_SCORE - best_score + 1) / 2;
-    std::cout << "mate " << mate_in;
-  }
-  else if (best_score <= -MATE_BOUND)
-  {
-    int mate_in = -(MATE_SCORE + best_score + 1) / 2;
-    std::cout << "mate " << mate_in;
-  }
-  else
-  {
-    std::cout << "cp " << best_score;
-  }
-  std::cout << " nodes " << nodes << " nps " << static_cast<int>(nps) << " time " << duration.count() << " hashfull "
-            << TT.hashfull();
-  if (best_move != 0)
-  {
-    std::cout << " pv " << uint_move_to_engine_string_move(best_move);
-  }
-  std::cout << std::endl;
-
-  // Update root score for next search
-  search_context.root_score = best_score;
+find_move_return_val find_move(Position* position)
+{
+  start_search(*position, nullptr);
+  wait_for_search();
+  return search_threads.last_result;
+}
 
-  return {best_move, nodes, duration, best_depth, best_score};
+find_move_return_val find_move_with_history(Position* position, const std::vector<uint64_t>& history)
+{
+  search_context.game_history = history;
+  return find_move(position);
 }
 
 // Adjust mate scores for TT storage (distance to mate)
@@ -474,46 +799,39 @@ static int score_from_tt(int score, int ply)
   return score;
 }
 
-// Generate capture moves only (for quiescence search)
-static std::vector<uint32_t> generate_captures(Position* position)
+// Captures and promotions only (for quiescence search)
+template <Color Us>
+static ScoredMoveList generate_captures(SearchWorker* worker, Position* position)
 {
-  std::vector<uint32_t> all_moves = valid_moves_for_position(*position);
-  std::vector<uint32_t> captures;
-  captures.reserve(32);
+  ScoredMoveList captures;
 
-  for (uint32_t move : all_moves)
+  // Scored by MVV-LVA, ordered one pick at a time by the caller
+  for (uint32_t move : generate_moves<Us>(position, CAPTURES))
   {
-    if (decode_capture(move))
-    {
-      captures.push_back(move);
-    }
+    captures.push_back(move, score_move(position, move, 0, {}, worker->history, &worker->moves_scored));
   }
 
-  // Sort captures by MVV-LVA
-  std::sort(captures.begin(), captures.end(),
-            [position](uint32_t m1, uint32_t m2)
-            {
-              PieceAsInt v1 = victim_on_square(position, static_cast<Square>(decode_to_square(m1)));
-              PieceAsInt v2 = victim_on_square(position, static_cast<Square>(decode_to_square(m2)));
-              PieceAsInt a1 = decode_moved_piece(m1);
-              PieceAsInt a2 = decode_moved_piece(m2);
-              return mvv_lva_table[a1][v1] > mvv_lva_table[a2][v2];
-            });
-
   return captures;
 }
 
 // Quiescence search - search captures until position is "quiet"
-static int_fast32_t quiescence_search(Position* position, int ply, int_fast32_t alpha, int_fast32_t beta,
-                                      uint64_t* nodes)
+template <Color Us>
+static int_fast32_t quiescence_search(SearchWorker* worker, Position* position, int ply, int_fast32_t alpha,
+                                      int_fast32_t beta)
 {
   // Check for time limit periodically
-  if ((*nodes & 4095) == 0 && should_stop())
+  if (should_stop_at_node(worker))
   {
     return 0;
   }
 
-  *nodes += 1;
+  worker->count_node();
+
+  // Only captures are searched here, so a mate would otherwise be scored by stand-pat. Counting is enough to tell.
+  if (is_in_check(position) && count_legal_moves<Us>(position) == 0)
+  {
+    return -MATE_SCORE + ply;
+  }
 
   // Stand-pat: evaluate current position
   int_fast32_t stand_pat = evaluate_position(position);
@@ -538,13 +856,20 @@ static int_fast32_t quiescence_search(Position* position, int ply, int_fast32_t
   }
 
   // Generate and search captures
-  std::vector<uint32_t> captures = generate_captures(position);
+  ScoredMoveList captures = generate_captures<Us>(worker, position);
 
-  for (uint32_t move : captures)
+  for (int i = 0; i < captures.size(); i++)
   {
-    Position new_position = make_move(position, move);
+    uint32_t move = captures.pick_best(i);
+    ChildPosition<Us> new_position(position, move);
 
-    int_fast32_t score = -quiescence_search(&new_position, ply + 1, -beta, -alpha, nodes);
+    int_fast32_t score = -quiescence_search<opposite(Us)>(worker, new_position.get(), ply + 1, -beta, -alpha);
+
+    // A stopped search unwinds without counting another node, its scores are never used
+    if (search_stopped.load(std::memory_order_relaxed))
+    {
+      return 0;
+    }
 
     if (score >= beta)
     {
@@ -560,22 +885,6 @@ static int_fast32_t quiescence_search(Position* position, int ply, int_fast32_t
   return alpha;
 }
 
-// Check if position is in check
-static bool is_in_check(Position* position)
-{
-  int king_sq;
-  if (position->white_to_move)
-  {
-    king_sq = bitscan(white_kings(position));
-    return is_square_attacked(true, king_sq, position);
-  }
-  else
-  {
-    king_sq = bitscan(black_kings(position));
-    return is_square_attacked(false, king_sq, position);
-  }
-}
-
 // Null move pruning parameters
 constexpr int NULL_MOVE_R = 3;  // Reduction depth
 constexpr int NULL_MOVE_MIN_DEPTH = 3;  // Minimum depth for null move
@@ -601,32 +910,45 @@ static void init_lmr()
   lmr_initialized = true;
 }
 
-int_fast32_t principal_variation_search(Position* position, int depth, int ply, int_fast32_t alpha, int_fast32_t beta,
-                                        uint64_t* nodes)
+// The side to move is fixed for the whole node, children are searched with the other side's instantiation so the
+// color is only looked up once at the root
+template <Color Us>
+static int_fast32_t principal_variation_search(SearchWorker* worker, Position* position, int depth, int ply,
+                                               int_fast32_t alpha, int_fast32_t beta)
 {
-  // Initialize LMR table on first call
-  init_lmr();
+  worker->pv.clear(ply);
 
   // Check for time limit periodically (every 4096 nodes)
-  if ((*nodes & 4095) == 0 && should_stop())
+  if (should_stop_at_node(worker))
   {
     return 0;
   }
 
-  // Check for draw by repetition
-  if (is_repetition(position->hash))
+  // Check for 50-move draw
+  if (position->half_move_clock >= 100)
   {
     return get_draw_score();
   }
 
-  // Check for 50-move draw
-  if (position->half_move_clock >= 100)
+  // Check for draw by repetition
+  if (is_repetition(worker, position, ply))
   {
     return get_draw_score();
   }
 
-  // Push current position to search stack for repetition detection
-  search_stack.push_back(position->hash);
+  // With a move back to a repeated position available a draw is the least this node is worth
+  int draw_score = get_draw_score();
+  if (alpha < draw_score && has_upcoming_repetition(worker, position, ply))
+  {
+    alpha = draw_score;
+    if (alpha >= beta)
+    {
+      return alpha;
+    }
+  }
+
+  // Push current position to the key history for repetition detection
+  worker->push_key(position->hash);
 
   bool is_pv = (beta - alpha) > 1;
   int_fast32_t original_alpha = alpha;
@@ -650,17 +972,17 @@ int_fast32_t principal_variation_search(Position* position, int depth, int ply,
 
       if (tt_entry->flag == TT_EXACT)
       {
-        search_stack.pop_back();
+        worker->pop_key();
         return tt_score;
       }
       else if (tt_entry->flag == TT_LOWER_BOUND && tt_score >= beta)
       {
-        search_stack.pop_back();
+        worker->pop_key();
         return tt_score;
       }
       else if (tt_entry->flag == TT_UPPER_BOUND && tt_score <= alpha)
       {
-        search_stack.pop_back();
+        worker->pop_key();
         return tt_score;
       }
     }
@@ -669,8 +991,8 @@ int_fast32_t principal_variation_search(Position* position, int depth, int ply,
   // Leaf node - enter quiescence search
   if (depth <= 0)
   {
-    search_stack.pop_back();
-    return quiescence_search(position, ply, alpha, beta, nodes);
+    worker->pop_key();
+    return quiescence_search<Us>(worker, position, ply, alpha, beta);
   }
 
   // Null move pruning
@@ -678,26 +1000,32 @@ int_fast32_t principal_variation_search(Position* position, int depth, int ply,
   if (!is_pv && !in_check && depth >= NULL_MOVE_MIN_DEPTH && ply > 0)
   {
     // Check for sufficient material (at least one non-pawn piece)
-    uint64_t our_pieces = position->white_to_move ? position->white : position->black;
-    uint64_t non_pawn_material = our_pieces & ~position->pawns & ~position->kings;
+    uint64_t non_pawn_material = pieces_of<Us>(position) & ~position->pawns & ~position->kings;
 
     if (non_pawn_material)
     {
       // Make null move (just flip side to move)
       Position null_position = *position;
-      null_position.white_to_move = !position->white_to_move;
+      null_position.white_to_move = Us != WHITE;
       null_position.enPassantTarget = 0;
       null_position.hash ^= zobrist::side_key;
+      null_position.half_move_clock = 0;  // Nothing before a null move can be repeated after it
       if (position->enPassantTarget)
       {
         null_position.hash ^= zobrist::ep_file_keys[file_of(bitscan(position->enPassantTarget))];
       }
 
-      *nodes += 1;
+      worker->count_node();
 
       // Search with reduced depth
       int R = NULL_MOVE_R + (depth > 6 ? 1 : 0);  // Adaptive reduction
-      int_fast32_t null_score = -principal_variation_search(&null_position, depth - 1 - R, ply + 1, -beta, -beta + 1, nodes);
+      int_fast32_t null_score = -principal_variation_search<opposite(Us)>(worker, &null_position, depth - 1 - R, ply + 1, -beta, -beta + 1);
+
+      if (search_stopped.load(std::memory_order_relaxed))
+      {
+        worker->pop_key();
+        return 0;
+      }
 
       // Null move cutoff
       if (null_score >= beta)
@@ -705,33 +1033,15 @@ int_fast32_t principal_variation_search(Position* position, int depth, int ply,
         // Don't return mate scores from null move search
         if (null_score >= MATE_BOUND)
           null_score = beta;
-        search_stack.pop_back();
+        worker->pop_key();
         return null_score;
       }
     }
   }
 
-  // Generate and order moves
-  std::vector<uint32_t> possible_moves = ordered_moves_for_search(position, depth, tt_move);
-
-  // No legal moves - checkmate or stalemate
-  if (possible_moves.empty())
-  {
-    search_stack.pop_back();
-    if (in_check)
-    {
-      // Checkmate - return mate score adjusted for ply (prefer shorter mates)
-      return -MATE_SCORE + ply;
-    }
-    else
-    {
-      // Stalemate - use draw contempt
-      return get_draw_score();
-    }
-  }
-
   int_fast32_t score;
   int moves_searched = 0;
+  int legal_moves = 0;
 
   // Get static eval for futility pruning
   int_fast32_t static_eval = evaluate_position(position);
@@ -741,8 +1051,14 @@ int_fast32_t principal_variation_search(Position* position, int depth, int ply,
   constexpr int FUTILITY_MARGIN_2 = 400;  // Depth 2
   constexpr int FUTILITY_MARGIN_3 = 600;  // Depth 3
 
-  for (uint32_t move : possible_moves)
+  // Moves are handed out stage by stage, a cutoff on an early move skips generating and sorting the rest
+  MovePicker picker(position, tt_move, killers_at(worker, depth), worker->history, &worker->moves_scored);
+  uint32_t move;
+
+  while ((move = picker.next_move()) != 0)
   {
+    legal_moves++;
+
     bool is_capture = decode_capture(move);
     bool gives_check = decode_check(move);
     bool is_promotion = decode_promoted_to_piece(move) != NO_PIECE;
@@ -764,8 +1080,8 @@ int_fast32_t principal_variation_search(Position* position, int depth, int ply,
       }
     }
 
-    Position new_position = make_move(position, move);
-    *nodes += 1;
+    ChildPosition<Us> new_position(position, move);
+    worker->count_node();
 
     int new_depth = depth - 1;
 
@@ -780,7 +1096,7 @@ int_fast32_t principal_variation_search(Position* position, int depth, int ply,
     if (moves_searched == 1)
     {
       // First move - full window search
-      score = -principal_variation_search(&new_position, new_depth, ply + 1, -beta, -alpha, nodes);
+      score = -principal_variation_search<opposite(Us)>(worker, new_position.get(), new_depth, ply + 1, -beta, -alpha);
     }
     else
     {
@@ -794,8 +1110,7 @@ int_fast32_t principal_variation_search(Position* position, int depth, int ply,
         reduction = lmr_reductions[std::min(depth, 63)][std::min(moves_searched, 63)];
 
         // Reduce less for killer moves
-        if (depth < MAX_KILLER_HISTORY_DEPTH &&
-            (killer_moves[depth][0] == move || killer_moves[depth][1] == move))
+        if (same_move(killers_at(worker, depth)[0], move) || same_move(killers_at(worker, depth)[1], move))
         {
           reduction = std::max(0, reduction - 1);
         }
@@ -805,21 +1120,28 @@ int_fast32_t principal_variation_search(Position* position, int depth, int ply,
       }
 
       // Zero-window search with possible reduction
-      score = -principal_variation_search(&new_position, new_depth - reduction, ply + 1, -alpha - 1, -alpha, nodes);
+      score = -principal_variation_search<opposite(Us)>(worker, new_position.get(), new_depth - reduction, ply + 1, -alpha - 1, -alpha);
 
       // Re-search at full depth if reduced search raises alpha
       if (reduction > 0 && score > alpha)
       {
-        score = -principal_variation_search(&new_position, new_depth, ply + 1, -alpha - 1, -alpha, nodes);
+        score = -principal_variation_search<opposite(Us)>(worker, new_position.get(), new_depth, ply + 1, -alpha - 1, -alpha);
       }
 
       // Re-search with full window if score falls within window (PVS)
       if (score > alpha && score < beta)
       {
-        score = -principal_variation_search(&new_position, new_depth, ply + 1, -beta, -alpha, nodes);
+        score = -principal_variation_search<opposite(Us)>(worker, new_position.get(), new_depth, ply + 1, -beta, -alpha);
       }
     }
 
+    // A stopped search unwinds without counting another node or storing its meaningless scores in the TT
+    if (search_stopped.load(std::memory_order_relaxed))
+    {
+      worker->pop_key();
+      return 0;
+    }
+
     if (score > best_score)
     {
       best_score = score;
@@ -829,6 +1151,10 @@ int_fast32_t principal_variation_search(Position* position, int depth, int ply,
     if (score > alpha)
     {
       alpha = score;
+      if (is_pv)
+      {
+        worker->pv.update(ply, move);
+      }
     }
 
     if (alpha >= beta)
@@ -836,19 +1162,35 @@ int_fast32_t principal_variation_search(Position* position, int depth, int ply,
       // Beta cutoff - update killer moves and history for quiet moves
       if (!decode_capture(move))
       {
-        if (depth < MAX_KILLER_HISTORY_DEPTH)
+        if (depth < MAX_KILLER_HISTORY_DEPTH && !same_move(worker->killer_moves[depth][0], move))
         {
-          killer_moves[depth][1] = killer_moves[depth][0];
-          killer_moves[depth][0] = move;
+          worker->killer_moves[depth][1] = worker->killer_moves[depth][0];
+          worker->killer_moves[depth][0] = move;
         }
-        history[decode_from_square(move)][decode_to_square(move)] += depth * depth;
+        worker->history[decode_from_square(move)][decode_to_square(move)] += depth * depth;
       }
       break;
     }
     else if (!decode_capture(move))
     {
       // Penalize moves that don't cause cutoff
-      history[decode_from_square(move)][decode_to_square(move)] -= depth * depth;
+      worker->history[decode_from_square(move)][decode_to_square(move)] -= depth * depth;
+    }
+  }
+
+  // No legal moves - checkmate or stalemate
+  if (legal_moves == 0)
+  {
+    worker->pop_key();
+    if (in_check)
+    {
+      // Checkmate - return mate score adjusted for ply (prefer shorter mates)
+      return -MATE_SCORE + ply;
+    }
+    else
+    {
+      // Stalemate - use draw contempt
+      return get_draw_score();
     }
   }
 
@@ -870,6 +1212,16 @@ int_fast32_t principal_variation_search(Position* position, int depth, int ply,
   TT.store(position->hash, depth, score_to_tt(best_score, ply), static_eval, flag, best_move);
 
   // Pop from search stack before returning
-  search_stack.pop_back();
+  worker->pop_key();
   return best_score;
 }
+
+int_fast32_t principal_variation_search(SearchWorker* worker, Position* position, int depth, int ply,
+                                        int_fast32_t alpha, int_fast32_t beta)
+{
+  // Initialize LMR table on first call
+  init_lmr();
+
+  return position->white_to_move ? principal_variation_search<WHITE>(worker, position, depth, ply, alpha, beta)
+                                 : principal_variation_search<BLACK>(worker, position, depth, ply, alpha, beta);
+}
@@ -1,13 +1,25 @@
 #ifndef SEARCH_H
 #define SEARCH_H
 
+#include <array>
 #include <atomic>
 #include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <thread>
 #include <vector>
 
 #include "../util/global.hpp"
+#include "movepicker.hpp"
+
+// One of the best lines from the root: its first move, its score and the moves expected after it
+struct SearchLine
+{
+  uint32_t move = 0;
+  int_fast32_t score = 0;
+  std::vector<uint32_t> pv;
+};
 
 struct find_move_return_val
 {
@@ -16,7 +28,10 @@ struct find_move_return_val
   std::chrono::milliseconds miliseconds_of_search_time;
   int depth;
   int_fast32_t position_score;
-  std::vector<uint32_t> principal_variation;
+  std::vector<uint32_t> principal_variation;  // The line expected from here, starting with best_move
+  uint64_t moves_scored;  // Move ordering scores computed, a measure of ordering cost
+  std::chrono::microseconds first_info_latency;  // From starting the search to its first info line
+  std::vector<SearchLine> lines;  // The main thread's last completed iteration, best first, MultiPV of them
 };
 
 // Search context for game history and draw detection
@@ -36,23 +51,135 @@ struct SearchContext
 // Global search context
 extern SearchContext search_context;
 
-// Set the search time limit in milliseconds
+// Line size assumed when keeping data written by one search thread off the lines other threads read
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+constexpr int MAX_KILLER_HISTORY_DEPTH = 100;
+
+// Plies of position history each search thread keeps. No repetition reaches back past the 100 plies of the fifty move
+// rule, a power of 2 above that makes the history a ring indexed with a mask.
+constexpr int KEY_HISTORY_SIZE = 128;
+
+// Longest line a principal variation keeps, past it checks extend the search without lengthening the line
+constexpr int MAX_PV_LENGTH = 128;
+
+// Triangular principal variation table. Row ply holds the best line found from the node at that ply, columns from ply
+// on: a move raising alpha at a PV node is put in front of the row below it, so each row only costs a copy of the line
+// under it and row 0 ends up with the line from the root.
+struct PrincipalVariation
+{
+  std::array<std::array<uint32_t, MAX_PV_LENGTH>, MAX_PV_LENGTH> moves = {};
+  std::array<int, MAX_PV_LENGTH> length = {};  // One past the last move of each row
+
+  // On entering a node, whose line is empty until one of its moves raises alpha
+  void clear(int ply)
+  {
+    if (ply < MAX_PV_LENGTH)
+    {
+      length[ply] = ply;
+    }
+  }
+
+  // move raised alpha at ply, after the child's search left the line below it in row ply + 1
+  void update(int ply, uint32_t move)
+  {
+    if (ply >= MAX_PV_LENGTH)
+    {
+      return;
+    }
+
+    moves[ply][ply] = move;
+    int child_length = ply + 1 < MAX_PV_LENGTH ? length[ply + 1] : ply + 1;
+    for (int i = ply + 1; i < child_length; i++)
+    {
+      moves[ply][i] = moves[ply + 1][i];
+    }
+    length[ply] = child_length;
+  }
+
+  std::vector<uint32_t> line(int ply) const
+  {
+    return {moves[ply].begin() + ply, moves[ply].begin() + length[ply]};
+  }
+};
+
+// Everything one search thread writes while it searches. Each worker starts on its own cache line, so no thread's
+// writes invalidate a line another thread is working from.
+struct alignas(CACHE_LINE_SIZE) SearchWorker
+{
+  int thread_id = 0;
+  std::array<KillerMoves, MAX_KILLER_HISTORY_DEPTH> killer_moves = {};
+  HistoryTable history = {};
+  std::array<uint64_t, KEY_HISTORY_SIZE> key_history = {};  // Hashes of the positions before the current node
+  int key_count = 0;  // Positions pushed, the ring holds the last KEY_HISTORY_SIZE of them
+  uint64_t moves_scored = 0;           // This thread's share of find_move_return_val::moves_scored
+  PrincipalVariation pv;
+
+  // Only the worker's own thread counts, so a relaxed load and store is enough and no locked add is needed. The main
+  // thread sums the counts of all workers whenever it reports.
+  void count_node() { nodes_.store(nodes_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+  uint64_t nodes() const { return nodes_.load(std::memory_order_relaxed); }
+  void clear_nodes() { nodes_.store(0, std::memory_order_relaxed); }
+
+  // The game since its last irreversible move then the search path, pushed on entering a node and popped on leaving
+  void push_key(uint64_t key) { key_history[key_count++ & (KEY_HISTORY_SIZE - 1)] = key; }
+  void pop_key() { key_count--; }
+  // Hash of the position plies before the current one, 1 being its parent. At most key_count plies back.
+  uint64_t key_back(int plies) const { return key_history[(key_count - plies) & (KEY_HISTORY_SIZE - 1)]; }
+
+private:
+  std::atomic<uint64_t> nodes_{0};
+};
+
+// Default time limit (overridden by time management)
+constexpr int DEFAULT_SEARCH_TIME_MS = 10000;
+
+// What ends a search besides "stop": the clock, and the depth and node count when they are non-zero. A depth or node
+// limited search on one thread plays the same move every time from the same TT and tables, see clear_search_tables.
+struct SearchLimits
+{
+  int time_ms = DEFAULT_SEARCH_TIME_MS;  // Hard limit, the search stops wherever it is
+  int optimum_ms = 0;  // Soft limit, no iteration is started past it once scaled by best move stability. 0 for none
+  int depth = 0;       // Deepest iteration to complete
+  uint64_t nodes = 0;  // Nodes to search, counted over all threads
+};
+
+void set_search_limits(const SearchLimits& limits);
+
+// Set the search time limit in milliseconds, with no depth or node limit
 void set_search_time_limit(int time_ms);
 
-// Set number of search threads
+// Forget every thread's history, so the searches of a new game do not depend on those of the last one
+void clear_search_tables();
+
+// Lines the main thread searches and reports, each the best root move not already in a line above it. The lines share
+// one iteration and one TT, and each is searched in an aspiration window around its score at the last depth, so
+// lines after the first mostly cost less than the first.
+constexpr int MAX_MULTI_PV = 256;
+void set_multi_pv(int lines);
+int get_multi_pv();
+
+// Set number of search threads. The threads are created here and parked between searches, not started per search.
 void set_thread_count(int threads);
 int get_thread_count();
 
 // Stop the current search
 void stop_search();
 
-// Main search functions
+// Start searching position on the search threads and return at once. on_done is called with the result from the main
+// search thread once every thread has finished.
+void start_search(const Position& position, std::function<void(const find_move_return_val&)> on_done);
+
+// Block until the last search started has finished and on_done has returned
+void wait_for_search();
+
+// Main search functions, these start a search and wait for it
 find_move_return_val find_move(Position* position);
 find_move_return_val find_move_with_history(Position* position, const std::vector<uint64_t>& history);
 uint32_t find_move_and_display_statistics(Position* position);
 
-// Internal search function
-int_fast32_t principal_variation_search(Position* position, int depth, int ply, int_fast32_t alpha, int_fast32_t beta,
-                                        uint64_t* nodes);
+// Internal search function, nodes are counted on the worker
+int_fast32_t principal_variation_search(SearchWorker* worker, Position* position, int depth, int ply,
+                                        int_fast32_t alpha, int_fast32_t beta);
 
 #endif
\ No newline at end of file
@@ -1,6 +1,7 @@
 #ifndef TRANSPOSITION_H
 #define TRANSPOSITION_H
 
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 
@@ -2,34 +2,40 @@
 
 #include <algorithm>
 
-int TimeManager::allocate_time(const TimeControl& tc, bool white_to_move, int ply)
+TimeBudget TimeManager::allocate_time(const TimeControl& tc, bool white_to_move, int ply)
 {
   // Fixed move time takes precedence
   if (tc.movetime > 0)
   {
-    return tc.movetime - MOVE_OVERHEAD;
+    return {0, tc.movetime - MOVE_OVERHEAD};
   }
 
   // Infinite search
   if (tc.infinite)
   {
-    return 1000000000;  // Effectively infinite
+    return {0, 1000000000};  // Effectively infinite
   }
 
   // Fixed depth search - use generous time
   if (tc.depth > 0)
   {
-    return 1000000000;  // Effectively infinite
+    return {0, 1000000000};  // Effectively infinite
   }
 
   // Get time and increment for side to move
   int time_remaining = white_to_move ? tc.wtime : tc.btime;
   int increment = white_to_move ? tc.winc : tc.binc;
 
+  // Fixed node search without a clock
+  if (tc.nodes > 0 && time_remaining <= 0)
+  {
+    return {0, 1000000000};  // Effectively infinite
+  }
+
   // Safety check
   if (time_remaining <= 0)
   {
-    return MIN_MOVE_TIME;
+    return {0, MIN_MOVE_TIME};
   }
 
   // Subtract move overhead
@@ -66,16 +72,8 @@ int TimeManager::allocate_time(const TimeControl& tc, bool white_to_move, int pl
   // Ensure minimum time
   allocated = std::max(allocated, MIN_MOVE_TIME);
 
-  return allocated;
-}
-
-bool TimeManager::should_extend(int elapsed_ms, int allocated_ms, bool pv_stable)
-{
-  // If PV is unstable (best move changed), consider extending
-  if (!pv_stable && elapsed_ms < allocated_ms * 2)
-  {
-    return true;
-  }
+  int optimum = std::max(static_cast<int>(allocated * OPTIMUM_FRACTION), MIN_MOVE_TIME);
+  int maximum = std::max(std::min(static_cast<int>(allocated * MAXIMUM_FRACTION), max_time), allocated);
 
-  return false;
+  return {optimum, maximum};
 }
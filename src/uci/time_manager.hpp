@@ -24,15 +24,19 @@ struct TimeControl
   }
 };
 
+// Time for one move in milliseconds. The search starts no new iteration once past the optimum, scaled by how settled
+// its best move is, and is stopped wherever it is at the maximum.
+struct TimeBudget
+{
+  int optimum_ms;  // 0 when the whole maximum is to be used, as for movetime
+  int maximum_ms;
+};
+
 class TimeManager
 {
 public:
   // Calculate time to allocate for this move
-  // Returns time in milliseconds
-  static int allocate_time(const TimeControl& tc, bool white_to_move, int ply);
-
-  // Check if we should extend search time (e.g., for important positions)
-  static bool should_extend(int elapsed_ms, int allocated_ms, bool pv_stable);
+  static TimeBudget allocate_time(const TimeControl& tc, bool white_to_move, int ply);
 
 private:
   // Safety margin to avoid flagging (ms)
@@ -43,6 +47,11 @@ private:
 
   // Maximum fraction of remaining time to use
   static constexpr float MAX_TIME_FRACTION = 0.7f;
+
+  // The optimum and maximum as fractions of the time allocated from the clock. Aiming at half the allocation leaves
+  // room for an unsettled best move, and for the iteration started last, without going over it on average.
+  static constexpr float OPTIMUM_FRACTION = 0.5f;
+  static constexpr float MAXIMUM_FRACTION = 2.0f;
 };
 
 #endif
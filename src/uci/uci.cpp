@@ -1,10 +1,12 @@
 #include "uci.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <random>
 #include <sstream>
 #include <vector>
 
+#include "../bench/bench.hpp"
 #include "../book/book.hpp"
 #include "../game/manager.hpp"
 #include "../search/search.hpp"
@@ -16,15 +18,6 @@ UCI::UCI() : manager() {};
 
 UCI::~UCI() { wait_for_search(); }
 
-void UCI::wait_for_search()
-{
-  if (search_thread.joinable())
-  {
-    search_thread.join();
-  }
-  searching.store(false, std::memory_order_relaxed);
-}
-
 void UCI::start()
 {
   std::string request;
@@ -62,6 +55,11 @@ void UCI::start()
       wait_for_search();  // Wait for any previous search
       go(request);
     }
+    else if (request.substr(0, 5) == "bench")
+    {
+      wait_for_search();
+      run_bench(request);
+    }
     else if (request == "stop")
     {
       stop_search();
@@ -85,6 +83,7 @@ void UCI::initiate()
   std::cout << "option name Hash type spin default 64 min 1 max 4096\n";
   std::cout << "option name Threads type spin default 1 min 1 max 64\n";
   std::cout << "option name OwnBook type check default false\n";
+  std::cout << "option name MultiPV type spin default 1 min 1 max " << MAX_MULTI_PV << "\n";
 
   std::cout << "uciok\n";
 }
@@ -96,6 +95,7 @@ void UCI::new_game()
   manager.new_game();
   TT.clear();
   search_context.clear();
+  clear_search_tables();
 }
 
 void UCI::update_position(const std::string& request)
@@ -166,6 +166,40 @@ void UCI::set_option(const std::string& request)
   {
     book::set_enabled(value == "true");
   }
+  else if (name == "MultiPV")
+  {
+    try
+    {
+      set_multi_pv(std::stoi(value));
+    }
+    catch (...)
+    {
+      // Invalid value, ignore
+    }
+  }
+}
+
+void UCI::run_bench(const std::string& request)
+{
+  // Parse: "bench [movetime_ms]"
+  std::istringstream iss(request);
+  std::string token;
+  int movetime_ms = bench::DEFAULT_BENCH_MOVETIME_MS;
+
+  iss >> token;
+  if (iss >> token)
+  {
+    try
+    {
+      movetime_ms = std::stoi(token);
+    }
+    catch (...)
+    {
+      // Invalid value, keep default
+    }
+  }
+
+  bench::run(movetime_ms);
 }
 
 TimeControl UCI::parse_go_command(const std::string& request)
@@ -232,8 +266,8 @@ void UCI::go(const std::string& request)
   bool white_to_move = pos.white_to_move;
   int ply = pos.full_move_clock * 2 + (white_to_move ? 0 : 1);
 
-  // Check opening book first (unless analyzing with infinite/fixed depth)
-  if (!tc.infinite && tc.depth == 0)
+  // Check opening book first (unless analyzing with infinite/fixed depth/fixed nodes)
+  if (!tc.infinite && tc.depth == 0 && tc.nodes == 0)
   {
     std::string book_move = book::probe(pos.hash);
     if (!book_move.empty())
@@ -253,37 +287,31 @@ void UCI::go(const std::string& request)
   }
 
   // Calculate time allocation
-  int time_ms;
+  TimeBudget budget;
   if (tc.depth > 0 || tc.infinite)
   {
     // For fixed depth or infinite, use very long time
-    time_ms = 1000000000;
+    budget = {0, 1000000000};
   }
   else
   {
-    time_ms = TimeManager::allocate_time(tc, white_to_move, ply);
+    budget = TimeManager::allocate_time(tc, white_to_move, ply);
   }
 
-  // Set the search time limit
-  set_search_time_limit(time_ms);
+  // Depth and node limits end the search on their own, the clock only when one was given too
+  uint64_t nodes = static_cast<uint64_t>(std::max<int64_t>(tc.nodes, 0));
+  set_search_limits(
+      {.time_ms = budget.maximum_ms, .optimum_ms = budget.optimum_ms, .depth = tc.depth, .nodes = nodes});
 
   // Set up search context with game history
   search_context.game_history = manager.get_position_hashes();
 
-  // Copy position for the search thread
-  Position position = manager.get_position();
-
-  // Run search on separate thread so UCI can process "stop"
-  searching.store(true, std::memory_order_relaxed);
-  search_thread = std::thread(
-      [this, position]() mutable
-      {
-        find_move_return_val result = find_move(&position);
-
-        // Output best move
-        std::string move_string = uint_move_to_engine_string_move(result.best_move);
-        std::cout << "bestmove " << move_string << "\n";
-
-        searching.store(false, std::memory_order_relaxed);
-      });
+  // The search runs on the search threads so UCI can process "stop", the main one reports the move when done
+  start_search(manager.get_position(),
+               [](const find_move_return_val& result)
+               {
+                 // 0000 is the null move, sent when there is no legal move to play
+                 std::string move = result.best_move ? uint_move_to_engine_string_move(result.best_move) : "0000";
+                 std::cout << "bestmove " << move << "\n";
+               });
 }
@@ -1,9 +1,7 @@
 #ifndef UCI_H
 #define UCI_H
 
-#include <atomic>
 #include <string>
-#include <thread>
 
 #include "../game/manager.hpp"
 #include "time_manager.hpp"
@@ -28,11 +26,8 @@ public:
   // Handle UCI setoption command
   void set_option(const std::string& request);
 
-private:
-  std::thread search_thread;
-  std::atomic<bool> searching{false};
-
-  void wait_for_search();
+  // Run the fixed-position benchmark ("bench [movetime_ms]")
+  void run_bench(const std::string& request);
 };
 
 #endif
@@ -2,25 +2,37 @@
 #define GLOBAL_H
 
 #include <array>
+#include <bit>
 #include <cstdint>
 #include <string>
 
+// Bit intrinsics. With <bit> these compile to TZCNT/POPCNT when the target has them and still work in constant
+// expressions, the table and loop versions are kept for standard libraries without it.
+#ifndef __cpp_lib_bitops
 // clang-format off
 constexpr int index64[64] = {
   0,  1,  48, 2,  57, 49, 28, 3,  61, 58, 50, 42, 38, 29, 17, 4,  62, 55, 59, 36, 53, 51,
   43, 22, 45, 39, 33, 30, 24, 18, 12, 5,  63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21,
   44, 32, 23, 11, 46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19, 9,  13, 8,  7,  6};
 // clang-format on
+#endif
 
-// A forward bitscan (get index of lsb)
+// A forward bitscan (get index of lsb), an empty bitboard scans to 0
 constexpr int bitscan(uint64_t bitboard)
 {
+#ifdef __cpp_lib_bitops
+  return std::countr_zero(bitboard) & 63;
+#else
   const uint64_t debruijn64 = static_cast<uint64_t>(0x03f79d71b4cb0a89);
   return index64[((bitboard & -bitboard) * debruijn64) >> 58];
+#endif
 }
 
 constexpr int bitcount(uint64_t bitboard)
 {
+#ifdef __cpp_lib_bitops
+  return std::popcount(bitboard);
+#else
   int count = 0;
   while (bitboard)
   {
@@ -28,6 +40,15 @@ constexpr int bitcount(uint64_t bitboard)
     bitboard &= bitboard - 1;
   }
   return count;
+#endif
+}
+
+// Index of the lsb, which is cleared, for looping over the squares of a bitboard
+constexpr int pop_lsb(uint64_t& bitboard)
+{
+  int square = bitscan(bitboard);
+  bitboard &= bitboard - 1;
+  return square;
 }
 
 uint64_t set_bit_high(uint64_t bitboard, int square);
@@ -70,6 +91,24 @@ constexpr uint64_t square_to_bitboard(Square sq) { return 1ull << sq; }
 constexpr uint64_t int_location_to_bitboard(int sq) { return 1ull << sq; }
 constexpr Square bitboard_to_square(uint64_t bitboard) { return static_cast<Square>(bitscan(bitboard)); }
 
+enum PieceAsInt
+{
+  KNIGHT,
+  BISHOP,
+  ROOK,
+  QUEEN,
+  PAWN,
+  KING,
+  NO_PIECE,
+};
+
+constexpr std::array<uint8_t, 64> EMPTY_BOARD = []
+{
+  std::array<uint8_t, 64> board{};
+  board.fill(NO_PIECE);
+  return board;
+}();
+
 struct Position
 {
   uint64_t black = 0;
@@ -81,6 +120,10 @@ struct Position
   uint64_t knights = 0;
   uint64_t pawns = 0;
 
+  // Piece type (PieceAsInt) on each square, NO_PIECE when empty, kept in step with the bitboards above so finding
+  // what stands on a square is a single load. The color comes from the white and black bitboards.
+  std::array<uint8_t, 64> board = EMPTY_BOARD;
+
   bool white_to_move = false;
 
   bool white_can_castle_kingside = false;
@@ -94,8 +137,27 @@ struct Position
   short int full_move_clock = 0;
 
   uint64_t hash = 0;  // Zobrist hash of the position
+
+  bool operator==(const Position&) const = default;
 };
 
+// Side to move, the values match the color index used by the zobrist keys and pawn attack tables
+enum Color
+{
+  BLACK,
+  WHITE,
+};
+
+constexpr Color opposite(Color color) { return color == WHITE ? BLACK : WHITE; }
+
+template <Color C>
+inline uint64_t pieces_of(Position* position)
+{
+  return C == WHITE ? position->white : position->black;
+}
+
+inline PieceAsInt piece_on(Position* position, int square) { return static_cast<PieceAsInt>(position->board[square]); }
+
 inline uint64_t white_kings(Position* position) { return position->white & position->kings; }
 inline uint64_t white_queens(Position* position) { return position->white & position->queens; }
 inline uint64_t white_rooks(Position* position) { return position->white & position->rooks; }
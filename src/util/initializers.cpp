@@ -67,21 +67,27 @@ void Util::Initializers::update_position_from_fen_token_0(Position *position, st
       {
         case 'k':
           position->kings |= square;
+          position->board[bitscan(square)] = KING;
           break;
         case 'q':
           position->queens |= square;
+          position->board[bitscan(square)] = QUEEN;
           break;
         case 'r':
           position->rooks |= square;
+          position->board[bitscan(square)] = ROOK;
           break;
         case 'b':
           position->bishops |= square;
+          position->board[bitscan(square)] = BISHOP;
           break;
         case 'n':
           position->knights |= square;
+          position->board[bitscan(square)] = KNIGHT;
           break;
         case 'p':
           position->pawns |= square;
+          position->board[bitscan(square)] = PAWN;
           break;
         default:
           throw new std::invalid_argument("Invalid value in first FEN token.");
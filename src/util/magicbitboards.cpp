@@ -1,19 +1,249 @@
 #include "magicbitboards.hpp"
 
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <cpuid.h>
+#include <immintrin.h>
+#define PEXT_BACKEND_AVAILABLE
+#endif
+
+namespace
+{
+
+template <bool rooks>
+constexpr std::array<MagicBB, 64> generate_magic_struct_tables()
+{
+  std::array<MagicBB, 64> table{};
+  uint32_t offset = 0;
+  for (int square = 0; square < 64; square++)
+  {
+    int bits = rooks ? rook_occupancy[square] : bishop_occupancy[square];
+    table[square].mask = rooks ? rook_full_occupancy[square] : bishop_full_occupancy[square];
+    table[square].magic = rooks ? rook_magic_numbers[square] : bishop_magic_numbers[square];
+    table[square].offset = offset;
+    table[square].shift = 64 - bits;
+    offset += 1u << bits;
+  }
+
+  return table;
+}
+
+constexpr auto magic_bishop_table = generate_magic_struct_tables<false>();
+constexpr auto magic_rook_table = generate_magic_struct_tables<true>();
+
+// All squares share one array, each square's slice sized to its own occupancy bits instead of the largest square's
+template <bool rooks>
+using SliderAttackTable = std::array<uint64_t, slider_table_size<rooks>()>;
+
+template <bool rooks>
+SliderAttackTable<rooks> build_magic_attack_table()
+{
+  const auto& magics = rooks ? magic_rook_table : magic_bishop_table;
+  SliderAttackTable<rooks> table{};
+  for (int square = 0; square < 64; square++)
+  {
+    int bits = rooks ? rook_occupancy[square] : bishop_occupancy[square];
+    uint64_t bitboard = 1ull << square;
+    for (int i = 0; i < (1 << bits); i++)
+    {
+      uint64_t occupancy = construct_occupancies(i, bits, magics[square].mask);
+      uint64_t magic_index = (occupancy * magics[square].magic) >> magics[square].shift;
+      table[magics[square].offset + magic_index] = rooks ? rook_attack_mask_for_bitboard(bitboard, occupancy)
+                                                         : bishop_attack_mask_for_bitboard(bitboard, occupancy);
+    }
+  }
+
+  return table;
+}
+
+alignas(64) const auto magic_bishop_attacks = build_magic_attack_table<false>();
+alignas(64) const auto magic_rook_attacks = build_magic_attack_table<true>();
+
+// Same slices as the magic tables, but within a slice attacks are stored in subset order. PEXT of the occupancy by the
+// mask gives the subset's position since construct_occupancies enumerates subsets in the same order.
+template <bool rooks>
+std::vector<uint64_t> build_pext_attack_table()
+{
+  std::vector<uint64_t> table;
+  table.reserve(slider_table_size<rooks>());
+  for (int square = 0; square < 64; square++)
+  {
+    int bits = rooks ? rook_occupancy[square] : bishop_occupancy[square];
+    uint64_t mask = rooks ? rook_full_occupancy[square] : bishop_full_occupancy[square];
+    uint64_t bitboard = 1ull << square;
+    for (int i = 0; i < (1 << bits); i++)
+    {
+      uint64_t occupancy = construct_occupancies(i, bits, mask);
+      table.push_back(rooks ? rook_attack_mask_for_bitboard(bitboard, occupancy)
+                            : bishop_attack_mask_for_bitboard(bitboard, occupancy));
+    }
+  }
+
+  return table;
+}
+
+bool cpu_has_bmi2()
+{
+#ifdef PEXT_BACKEND_AVAILABLE
+  unsigned int eax, ebx, ecx, edx;
+  return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & bit_BMI2);
+#else
+  return false;
+#endif
+}
+
+// Every BMI2 CPU but AMD's before family 0x19 (Zen 3) runs PEXT in hardware
+bool cpu_has_fast_pext()
+{
+#ifdef PEXT_BACKEND_AVAILABLE
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(0, &eax, &ebx, &ecx, &edx))
+  {
+    return false;
+  }
+
+  char vendor[12];
+  std::memcpy(vendor, &ebx, 4);
+  std::memcpy(vendor + 4, &edx, 4);
+  std::memcpy(vendor + 8, &ecx, 4);
+  if (std::memcmp(vendor, "AuthenticAMD", 12) != 0)
+  {
+    return true;
+  }
+
+  __get_cpuid(1, &eax, &ebx, &ecx, &edx);
+  unsigned int family = (eax >> 8) & 0xf;
+  if (family == 0xf)
+  {
+    family += (eax >> 20) & 0xff;
+  }
+  return family >= 0x19;
+#else
+  return false;
+#endif
+}
+
+const bool bmi2_supported = cpu_has_bmi2();
+
+// Only built when they can be used
+const auto pext_bishop_attacks = bmi2_supported ? build_pext_attack_table<false>() : std::vector<uint64_t>{};
+const auto pext_rook_attacks = bmi2_supported ? build_pext_attack_table<true>() : std::vector<uint64_t>{};
+
+}  // namespace
+
+SliderBackend pick_slider_backend(bool bmi2, bool pext_fast, const char* forced)
+{
+  if (!bmi2)
+  {
+    return MAGIC;
+  }
+  if (forced && std::string(forced) == "magic")
+  {
+    return MAGIC;
+  }
+  if (forced && std::string(forced) == "pext")
+  {
+    return PEXT;
+  }
+  return pext_fast ? PEXT : MAGIC;
+}
+
+const SliderBackend slider_backend =
+    pick_slider_backend(bmi2_supported, cpu_has_fast_pext(), std::getenv(SLIDER_BACKEND_ENV));
+
+bool pext_supported() { return bmi2_supported; }
+
+uint64_t bishop_attacks_magic(uint64_t occupancy, int square)
+{
+  const MagicBB& magic = magic_bishop_table[square];
+  return magic_bishop_attacks[magic.offset + (((occupancy & magic.mask) * magic.magic) >> magic.shift)];
+}
+
+uint64_t rook_attacks_magic(uint64_t occupancy, int square)
+{
+  const MagicBB& magic = magic_rook_table[square];
+  return magic_rook_attacks[magic.offset + (((occupancy & magic.mask) * magic.magic) >> magic.shift)];
+}
+
+#ifdef PEXT_BACKEND_AVAILABLE
+__attribute__((target("bmi2"))) uint64_t bishop_attacks_pext(uint64_t occupancy, int square)
+{
+  const MagicBB& magic = magic_bishop_table[square];
+  return pext_bishop_attacks[magic.offset + _pext_u64(occupancy, magic.mask)];
+}
+
+__attribute__((target("bmi2"))) uint64_t rook_attacks_pext(uint64_t occupancy, int square)
+{
+  const MagicBB& magic = magic_rook_table[square];
+  return pext_rook_attacks[magic.offset + _pext_u64(occupancy, magic.mask)];
+}
+#else
+uint64_t bishop_attacks_pext(uint64_t occupancy, int square) { return bishop_attacks_magic(occupancy, square); }
+
+uint64_t rook_attacks_pext(uint64_t occupancy, int square) { return rook_attacks_magic(occupancy, square); }
+#endif
+
+// Four ray directions per vector, one direction in each lane
+typedef uint64_t DirectionLanes __attribute__((vector_size(32)));
+
+// Lanes are east, south, south east and south west when shifting left, and the opposite directions when shifting right.
+// Each mask drops the squares a shift wraps onto from the other edge of the board.
+constexpr DirectionLanes direction_shifts = {1, 8, 9, 7};
+constexpr DirectionLanes left_shift_masks = {NOT_FILE_A, ~0ull, NOT_FILE_A, NOT_FILE_H};
+constexpr DirectionLanes right_shift_masks = {NOT_FILE_H, ~0ull, NOT_FILE_H, NOT_FILE_A};
+
+template <bool left>
+static inline DirectionLanes shift_lanes(DirectionLanes bitboards, DirectionLanes shifts)
+{
+  return left ? bitboards << shifts : bitboards >> shifts;
+}
+
+// Kogge-Stone occluded fill, sliders spread through empty squares in doubling steps and then one more step onto the
+// first blocker
+template <bool left>
+static inline DirectionLanes occluded_fill_attacks(DirectionLanes sliders, uint64_t empty)
+{
+  constexpr DirectionLanes masks = left ? left_shift_masks : right_shift_masks;
+  DirectionLanes propagators = empty & masks;
+
+  sliders |= propagators & shift_lanes<left>(sliders, direction_shifts);
+  propagators &= shift_lanes<left>(propagators, direction_shifts);
+  sliders |= propagators & shift_lanes<left>(sliders, direction_shifts * 2);
+  propagators &= shift_lanes<left>(propagators, direction_shifts * 2);
+  sliders |= propagators & shift_lanes<left>(sliders, direction_shifts * 4);
+
+  return shift_lanes<left>(sliders, direction_shifts) & masks;
+}
+
+SliderAttackMaps slider_attacks_setwise(uint64_t bishops, uint64_t rooks, uint64_t queens, uint64_t occupancy)
+{
+  uint64_t empty = ~occupancy;
+
+  // Rooks ride the two straight lanes and bishops the two diagonal ones, queens need all four
+  DirectionLanes rooks_and_bishops = {rooks, rooks, bishops, bishops};
+  DirectionLanes all_queens = {queens, queens, queens, queens};
+
+  DirectionLanes split_lanes =
+      occluded_fill_attacks<true>(rooks_and_bishops, empty) | occluded_fill_attacks<false>(rooks_and_bishops, empty);
+  DirectionLanes queen_lanes = occluded_fill_attacks<true>(all_queens, empty) |
+                                 occluded_fill_attacks<false>(all_queens, empty);
+
+  return {split_lanes[2] | split_lanes[3], split_lanes[0] | split_lanes[1],
+          queen_lanes[0] | queen_lanes[1] | queen_lanes[2] | queen_lanes[3]};
+}
+
 uint64_t bishop_attacks(uint64_t occupancy, int square)
 {
-  occupancy &= magic_bishop_table[square].mask;
-  occupancy *= magic_bishop_table[square].magic;
-  occupancy >>= 64 - bishop_occupancy[square];
-  return magic_bishop_attacks[square][occupancy];
+  return slider_backend == PEXT ? bishop_attacks_pext(occupancy, square) : bishop_attacks_magic(occupancy, square);
 }
 
 uint64_t rook_attacks(uint64_t occupancy, int square)
 {
-  occupancy &= magic_rook_table[square].mask;
-  occupancy *= magic_rook_table[square].magic;
-  occupancy >>= 64 - rook_occupancy[square];
-  return magic_rook_attacks[square][occupancy];
+  return slider_backend == PEXT ? rook_attacks_pext(occupancy, square) : rook_attacks_magic(occupancy, square);
 }
 
 uint64_t queen_attacks(uint64_t occupancy, int square)
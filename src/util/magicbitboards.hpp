@@ -88,10 +88,13 @@ constexpr auto king_moves_for_bitboard(uint64_t bitboard)
 constexpr auto knight_moves = piece_table_generator(knight_moves_for_bitboard);
 constexpr auto king_moves = piece_table_generator(king_moves_for_bitboard);
 
+// Where a square's attacks live in its packed table, the magic index is added to offset
 struct MagicBB
 {
   uint64_t mask;
   uint64_t magic;
+  uint32_t offset;
+  int shift;
 };
 
 // Easier to store the magic numbers then generate them at compile time
@@ -126,53 +129,53 @@ constexpr std::array<uint64_t, 64> bishop_magic_numbers = {
     0x4010801011c04ULL,    0xa010109502200ULL,    0x4a02012000ULL,       0x500201010098b028ULL, 0x8040002811040900ULL,
     0x28000010020204ULL,   0x6000020202d0240ULL,  0x8918844842082200ULL, 0x4010011029020020ULL};
 
-template <std::size_t Length, bool rooks>
-constexpr auto attack_table()
+// Every square gets 2^bits entries, as many as its occupancy mask has subsets
+template <bool rooks>
+constexpr std::size_t slider_table_size()
 {
-  std::array<std::array<uint64_t, Length>, 64> attack_table{};
+  std::size_t size = 0;
   for (int square = 0; square < 64; square++)
   {
-    std::array<uint64_t, Length> attack_table_for_square{};
-    uint64_t bitboard = 1ull << square;
-    for (int i = 0; i < Length; i++)
-    {
-      uint64_t occupancy = construct_occupancies(i, rooks ? rook_occupancy[square] : bishop_occupancy[square],
-                                                 rooks ? rook_full_occupancy[square] : bishop_full_occupancy[square]);
-
-      uint64_t magic_index = occupancy;
-      magic_index *= rooks ? rook_magic_numbers[square] : bishop_magic_numbers[square];
-      magic_index >>= 64 - (rooks ? rook_occupancy[square] : bishop_occupancy[square]);
-
-      attack_table_for_square[magic_index] = rooks ? rook_attack_mask_for_bitboard(bitboard, occupancy)
-                                                   : bishop_attack_mask_for_bitboard(bitboard, occupancy);
-    }
-    attack_table[square] = attack_table_for_square;
+    size += 1ull << (rooks ? rook_occupancy[square] : bishop_occupancy[square]);
   }
 
-  return attack_table;
+  return size;
 }
 
-const auto magic_bishop_attacks = attack_table<512, false>();
-const auto magic_rook_attacks = attack_table<4096, true>();
-
-template <bool rooks>
-constexpr std::array<MagicBB, 64> generate_magic_struct_tables()
+// How slider attack tables are indexed, PEXT (BMI2) removes the magic multiply and shift
+enum SliderBackend
 {
-  std::array<MagicBB, 64> table{};
-  for (int i = 0; i < 64; i++)
-  {
-    MagicBB magicBB;
-    magicBB.magic = rooks ? rook_magic_numbers[i] : bishop_magic_numbers[i];
-    magicBB.mask = rooks ? rook_full_occupancy[i] : bishop_full_occupancy[i];
+  MAGIC,
+  PEXT,
+};
 
-    table[i] = magicBB;
-  }
+// Environment variable that forces a backend, "magic" or "pext". PEXT is only used where the CPU supports it.
+constexpr const char* SLIDER_BACKEND_ENV = "PHASE_SLIDER_BACKEND";
 
-  return table;
-}
+// The backend for a CPU: forced wins when it names one the CPU can run, otherwise PEXT where it is both supported and
+// fast. Zen 1 and Zen 2 support PEXT but run it in microcode, many times slower than a magic multiply.
+SliderBackend pick_slider_backend(bool bmi2, bool pext_fast, const char* forced);
+
+// Picked once at startup from CPUID and SLIDER_BACKEND_ENV, never changed after, so lookups branch on a constant
+extern const SliderBackend slider_backend;
+bool pext_supported();
+
+// Each backend on its own, the PEXT versions fall back to magics when the build target has no BMI2 support
+uint64_t bishop_attacks_magic(uint64_t occupancy, int square);
+uint64_t rook_attacks_magic(uint64_t occupancy, int square);
+uint64_t bishop_attacks_pext(uint64_t occupancy, int square);
+uint64_t rook_attacks_pext(uint64_t occupancy, int square);
+
+// Attacks of every bishop, rook and queen in the sets at once, kept apart by piece type
+struct SliderAttackMaps
+{
+  uint64_t bishops;
+  uint64_t rooks;
+  uint64_t queens;
+};
 
-const auto magic_bishop_table = generate_magic_struct_tables<false>();
-const auto magic_rook_table = generate_magic_struct_tables<true>();
+// Set-wise Kogge-Stone fills, for whole-side attack maps where a lookup per square would repeat work
+SliderAttackMaps slider_attacks_setwise(uint64_t bishops, uint64_t rooks, uint64_t queens, uint64_t occupancy);
 
 uint64_t bishop_attacks(uint64_t occupancy, int square);
 uint64_t rook_attacks(uint64_t occupancy, int square);
@@ -1,6 +1,11 @@
 #include "zobrist.hpp"
 
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
 #include "../game/moves.hpp"
+#include "magicbitboards.hpp"
 
 namespace zobrist
 {
@@ -10,6 +15,8 @@ uint64_t piece_keys[2][6][64];
 uint64_t castling_keys[16];
 uint64_t ep_file_keys[8];
 uint64_t side_key;
+uint64_t cuckoo_keys[CUCKOO_SIZE];
+ReversibleMove cuckoo_moves[CUCKOO_SIZE];
 
 // Simple xorshift64 PRNG for generating random keys
 // Using a fixed seed for reproducibility
@@ -23,6 +30,63 @@ static uint64_t xorshift64()
   return rand_state * 0x2545F4914F6CDD1DULL;
 }
 
+// Squares a piece attacks from square on an empty board
+static uint64_t empty_board_attacks(int piece, int square)
+{
+  switch (piece)
+  {
+    case KNIGHT:
+      return knight_moves[square];
+    case BISHOP:
+      return bishop_attacks(0, square);
+    case ROOK:
+      return rook_attacks(0, square);
+    case QUEEN:
+      return queen_attacks(0, square);
+    default:
+      return king_moves[square];
+  }
+}
+
+static void init_cuckoo()
+{
+  std::fill(std::begin(cuckoo_keys), std::end(cuckoo_keys), 0);
+  std::fill(std::begin(cuckoo_moves), std::end(cuckoo_moves), ReversibleMove{});
+
+  for (int color = 0; color < 2; color++)
+  {
+    for (int piece : {KNIGHT, BISHOP, ROOK, QUEEN, KING})
+    {
+      for (int from = 0; from < 64; from++)
+      {
+        for (int to = from + 1; to < 64; to++)
+        {
+          if (!(empty_board_attacks(piece, from) & int_location_to_bitboard(to)))
+          {
+            continue;
+          }
+
+          // Each insert takes its first free slot of the two, pushing out whatever held it to its other slot
+          ReversibleMove move = {static_cast<uint8_t>(color), static_cast<uint8_t>(piece),
+                                 static_cast<uint8_t>(from), static_cast<uint8_t>(to)};
+          uint64_t key = piece_keys[color][piece][from] ^ piece_keys[color][piece][to] ^ side_key;
+          int slot = cuckoo_slot_1(key);
+          while (true)
+          {
+            std::swap(cuckoo_keys[slot], key);
+            std::swap(cuckoo_moves[slot], move);
+            if (key == 0)
+            {
+              break;
+            }
+            slot = slot == cuckoo_slot_1(key) ? cuckoo_slot_2(key) : cuckoo_slot_1(key);
+          }
+        }
+      }
+    }
+  }
+}
+
 void init()
 {
   // Reset PRNG state for reproducible keys
@@ -54,6 +118,8 @@ void init()
 
   // Generate side to move key
   side_key = xorshift64();
+
+  init_cuckoo();
 }
 
 uint64_t compute_hash(const Position& pos)
@@ -64,7 +130,7 @@ uint64_t compute_hash(const Position& pos)
   uint64_t occupied = pos.white | pos.black;
   while (occupied)
   {
-    int sq = bitscan(occupied);
+    int sq = pop_lsb(occupied);
     uint64_t sq_bb = 1ULL << sq;
 
     // Determine color (0 = black, 1 = white)
@@ -86,8 +152,6 @@ uint64_t compute_hash(const Position& pos)
       piece_type = KING;
 
     hash ^= piece_keys[color][piece_type][sq];
-
-    occupied &= occupied - 1;  // Clear LSB
   }
 
   // Hash castling rights
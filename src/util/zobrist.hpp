@@ -16,7 +16,41 @@ extern uint64_t castling_keys[16];  // 4-bit index for all castling combinations
 extern uint64_t ep_file_keys[8];    // en passant file (0-7)
 extern uint64_t side_key;           // XOR when black to move
 
-// Initialize all Zobrist keys (call once at startup)
+// A move any piece but a pawn can make between two squares and back again, so one that can repeat a position
+struct ReversibleMove
+{
+  uint8_t color;
+  uint8_t piece;  // PieceAsInt
+  uint8_t from;
+  uint8_t to;
+};
+
+// Every reversible move, from either of its squares, keyed by what it xors into the hash including the side key.
+// Stored by cuckoo hashing so a key is in one of two slots, and two positions a single reversible move apart are
+// recognised with two loads.
+constexpr int CUCKOO_SIZE = 8192;
+extern uint64_t cuckoo_keys[CUCKOO_SIZE];
+extern ReversibleMove cuckoo_moves[CUCKOO_SIZE];
+
+inline int cuckoo_slot_1(uint64_t key) { return key & (CUCKOO_SIZE - 1); }
+inline int cuckoo_slot_2(uint64_t key) { return (key >> 16) & (CUCKOO_SIZE - 1); }
+
+// The reversible move that turns a position's hash into one differing from it by move_key, if there is one
+inline const ReversibleMove* find_reversible_move(uint64_t move_key)
+{
+  int slot = cuckoo_slot_1(move_key);
+  if (cuckoo_keys[slot] != move_key)
+  {
+    slot = cuckoo_slot_2(move_key);
+    if (cuckoo_keys[slot] != move_key)
+    {
+      return nullptr;
+    }
+  }
+  return &cuckoo_moves[slot];
+}
+
+// Initialize all Zobrist keys and the reversible move table built from them (call once at startup)
 void init();
 
 // Compute hash from scratch for a position
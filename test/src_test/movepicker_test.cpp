@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+#include "../../src/game/moves.hpp"
+#include "../../src/search/movepicker.hpp"
+#include "../../src/util/initializers.hpp"
+#include "../../src/util/zobrist.hpp"
+
+class MovePickerTest : public ::testing::Test
+{
+protected:
+  void SetUp() override { zobrist::init(); }
+
+  HistoryTable history = {};
+  uint64_t moves_scored = 0;
+
+  std::vector<uint32_t> picked_moves(Position* position, uint32_t tt_move, const KillerMoves& killers)
+  {
+    MovePicker picker(position, tt_move, killers, history, &moves_scored);
+    std::vector<uint32_t> moves;
+    uint32_t move;
+    while ((move = picker.next_move()) != 0)
+    {
+      moves.push_back(move);
+    }
+    return moves;
+  }
+
+  uint32_t find_move(Position* position, const std::string& engine_move)
+  {
+    for (uint32_t move : valid_moves_for_position(*position))
+    {
+      if (uint_move_to_engine_string_move(move) == engine_move)
+      {
+        return move;
+      }
+    }
+    return 0;
+  }
+};
+
+TEST_F(MovePickerTest, ReturnsEveryLegalMoveOnce)
+{
+  std::vector<std::string> fens = {
+      "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+      "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+      "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+  };
+
+  for (const std::string& fen : fens)
+  {
+    Position pos = Util::Initializers::fen_string_to_position(fen);
+    MoveList legal = valid_moves_for_position(pos);
+    std::vector<uint32_t> expected(legal.begin(), legal.end());
+
+    // A legal TT move, one legal and one stale killer
+    KillerMoves killers = {legal[legal.size() - 1], encode_move(a4, a5, true, KING, NO_PIECE, false, false, false, false)};
+    std::vector<uint32_t> picked = picked_moves(&pos, legal[legal.size() / 2], killers);
+
+    std::sort(expected.begin(), expected.end());
+    std::sort(picked.begin(), picked.end());
+    EXPECT_EQ(picked, expected) << fen;
+  }
+}
+
+TEST_F(MovePickerTest, StageOrder)
+{
+  // Qxa4 wins a pawn, Qxd5 loses the queen to the e6 pawn
+  Position pos = Util::Initializers::fen_string_to_position("4k3/8/4p3/3p4/p7/8/8/3QK3 w - - 0 1");
+  uint32_t tt_move = find_move(&pos, "d1d2");
+  uint32_t killer = find_move(&pos, "e1f2");
+  ASSERT_NE(tt_move, 0u);
+  ASSERT_NE(killer, 0u);
+
+  std::vector<uint32_t> picked = picked_moves(&pos, tt_move, {killer, 0});
+  ASSERT_GE(picked.size(), 4u);
+  EXPECT_EQ(uint_move_to_engine_string_move(picked[0]), "d1d2");
+  EXPECT_EQ(uint_move_to_engine_string_move(picked[1]), "d1a4");
+  EXPECT_EQ(uint_move_to_engine_string_move(picked[2]), "e1f2");
+  EXPECT_EQ(uint_move_to_engine_string_move(picked.back()), "d1d5");
+}
+
+TEST_F(MovePickerTest, StaticExchangeEvaluation)
+{
+  // Pawn takes a knight defended by a pawn
+  Position pos = Util::Initializers::fen_string_to_position("4k3/8/2p5/3n4/4P3/8/8/4K3 w - - 0 1");
+  EXPECT_EQ(static_exchange_evaluation(&pos, find_move(&pos, "e4d5")), 220);
+
+  // Rook takes a pawn defended by a rook, the second rook behind it joins through the x-ray
+  pos = Util::Initializers::fen_string_to_position("3rk3/8/8/3p4/8/8/3R4/3RK3 w - - 0 1");
+  EXPECT_EQ(static_exchange_evaluation(&pos, find_move(&pos, "d2d5")), 100);
+
+  // Queen takes a pawn defended by a pawn
+  pos = Util::Initializers::fen_string_to_position("4k3/8/4p3/3p4/8/8/8/3QK3 w - - 0 1");
+  EXPECT_EQ(static_exchange_evaluation(&pos, find_move(&pos, "d1d5")), -800);
+}
+
+TEST_F(MovePickerTest, PickBestReturnsMovesInScoreOrder)
+{
+  ScoredMoveList moves;
+  moves.push_back(1, 10);
+  moves.push_back(2, -5);
+  moves.push_back(3, 40);
+  moves.push_back(4, 20);
+
+  std::vector<uint32_t> picked;
+  for (int i = 0; i < moves.size(); i++)
+  {
+    picked.push_back(moves.pick_best(i));
+  }
+  EXPECT_EQ(picked, (std::vector<uint32_t>{3, 4, 1, 2}));
+}
@@ -0,0 +1,371 @@
+#include <gtest/gtest.h>
+
+#include "../../src/game/moves.hpp"
+#include "../../src/util/initializers.hpp"
+#include "../../src/util/zobrist.hpp"
+
+class MovesTest : public ::testing::Test
+{
+protected:
+  void SetUp() override { zobrist::init(); }
+
+  uint64_t perft(Position position, int depth)
+  {
+    if (depth == 0)
+    {
+      return 1;
+    }
+
+    uint64_t nodes = 0;
+    for (uint32_t move : valid_moves_for_position(position))
+    {
+      nodes += perft(make_move(&position, move), depth - 1);
+    }
+    return nodes;
+  }
+
+  uint64_t perft_fen(const std::string& fen, int depth)
+  {
+    return perft(Util::Initializers::fen_string_to_position(fen), depth);
+  }
+};
+
+TEST_F(MovesTest, PerftStartingPosition)
+{
+  Position pos = Util::Initializers::starting_position();
+  EXPECT_EQ(perft(pos, 1), 20);
+  EXPECT_EQ(perft(pos, 2), 400);
+  EXPECT_EQ(perft(pos, 3), 8902);
+}
+
+TEST_F(MovesTest, PerftKiwipete)
+{
+  // Castling, pins, en passant and promotions all in one position
+  std::string fen = "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1";
+  EXPECT_EQ(perft_fen(fen, 1), 48);
+  EXPECT_EQ(perft_fen(fen, 2), 2039);
+  EXPECT_EQ(perft_fen(fen, 3), 97862);
+}
+
+TEST_F(MovesTest, PerftChecksAndPromotions)
+{
+  EXPECT_EQ(perft_fen("8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 4), 43238);
+  EXPECT_EQ(perft_fen("r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 3), 9467);
+  EXPECT_EQ(perft_fen("rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 3), 62379);
+}
+
+TEST_F(MovesTest, PerftMirroredPositionsMatch)
+{
+  // The same positions with colors swapped and black to move run the other side's generator instantiation
+  EXPECT_EQ(perft_fen("r3k2r/pppbbppp/2n2q1P/1P2p3/3pn3/BN2PNP1/P1PPQPB1/R3K2R b KQkq - 0 1", 3), 97862);
+  EXPECT_EQ(perft_fen("r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1", 3), 9467);
+  EXPECT_EQ(perft_fen("8/4p1p1/8/1r3P1K/kp5R/3P4/2P5/8 b - - 0 1", 4), 43238);
+}
+
+TEST_F(MovesTest, EnPassantDiscoveredCheckIsIllegal)
+{
+  // Capturing en passant would expose the black king along the fourth rank
+  EXPECT_EQ(perft_fen("8/8/8/8/k2Pp2Q/8/8/3K4 b - d3 0 1", 1), 6);
+}
+
+TEST_F(MovesTest, EnPassantResolvesPawnCheck)
+{
+  // The double-pushed pawn gives check and can only be removed en passant
+  EXPECT_EQ(perft_fen("8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1", 6), 1440467);
+}
+
+TEST_F(MovesTest, PinnedPiecesMoveAlongPin)
+{
+  // The d2 rook is pinned by the d8 rook and may only slide along the d-file
+  Position pos = Util::Initializers::fen_string_to_position("3r3k/8/8/8/8/8/3R4/3K4 w - - 0 1");
+  MoveList moves = valid_moves_for_position(pos);
+  ASSERT_FALSE(moves.empty());
+  for (uint32_t move : moves)
+  {
+    if (decode_from_square(move) == d2)
+    {
+      EXPECT_EQ(file_of(decode_to_square(move)), file_of(d2));
+    }
+  }
+}
+
+TEST_F(MovesTest, CheckFlagMatchesMadePosition)
+{
+  // Direct, discovered, promotion, en passant and castling checks all appear within two plies of these
+  std::vector<std::string> fens = {
+      "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+      "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+      "2K2r2/4P3/8/8/8/8/8/3k4 w - - 0 1",
+      "5k2/8/8/8/8/8/8/4K2R w K - 0 1",
+  };
+
+  for (const std::string& fen : fens)
+  {
+    Position pos = Util::Initializers::fen_string_to_position(fen);
+    for (uint32_t move : valid_moves_for_position(pos))
+    {
+      Position after = make_move(&pos, move);
+      for (uint32_t reply : valid_moves_for_position(after))
+      {
+        Position after_reply = make_move(&after, reply);
+        int king_square = bitscan(after_reply.white_to_move ? white_kings(&after_reply) : black_kings(&after_reply));
+        EXPECT_EQ(decode_check(reply), is_square_attacked(after_reply.white_to_move, king_square, &after_reply))
+            << fen << " " << uint_move_to_engine_string_move(move) << " " << uint_move_to_engine_string_move(reply);
+      }
+    }
+  }
+}
+
+TEST_F(MovesTest, BoardMatchesBitboards)
+{
+  // Captures, en passant, castling and promotions all change the board array within two plies of these
+  std::vector<std::string> fens = {
+      "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+      "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+  };
+
+  auto expect_board_matches = [](Position* position)
+  {
+    const std::array<uint64_t, 6> piece_bitboards = {position->knights, position->bishops, position->rooks,
+                                                     position->queens,  position->pawns,   position->kings};
+    for (int square = 0; square < 64; square++)
+    {
+      PieceAsInt expected = NO_PIECE;
+      for (int piece = KNIGHT; piece <= KING; piece++)
+      {
+        if (piece_bitboards[piece] & int_location_to_bitboard(square))
+        {
+          expected = static_cast<PieceAsInt>(piece);
+        }
+      }
+      ASSERT_EQ(piece_on(position, square), expected) << int_to_square_string(square);
+    }
+  };
+
+  for (const std::string& fen : fens)
+  {
+    Position pos = Util::Initializers::fen_string_to_position(fen);
+    expect_board_matches(&pos);
+    for (uint32_t move : valid_moves_for_position(pos))
+    {
+      Position after = make_move(&pos, move);
+      expect_board_matches(&after);
+      for (uint32_t reply : valid_moves_for_position(after))
+      {
+        Position after_reply = make_move(&after, reply);
+        expect_board_matches(&after_reply);
+      }
+    }
+  }
+}
+
+TEST_F(MovesTest, AttackMapsMatchSquareScan)
+{
+  std::vector<std::string> fens = {
+      "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+      "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+  };
+
+  auto expect_maps_match = [](Position* position)
+  {
+    for (bool white : {true, false})
+    {
+      AttackMaps maps = attack_maps(white, position);
+      uint64_t pieces = white ? position->white : position->black;
+      uint64_t occupancy = all_occupied(position);
+      uint64_t sliders[3] = {0, 0, 0};
+      for (uint64_t bitboard = pieces; bitboard; bitboard &= bitboard - 1)
+      {
+        int square = bitscan(bitboard);
+        PieceAsInt piece = piece_on(position, square);
+        if (piece == BISHOP || piece == ROOK || piece == QUEEN)
+        {
+          sliders[piece - BISHOP] |= piece == BISHOP ? bishop_attacks(occupancy, square)
+                                     : piece == ROOK ? rook_attacks(occupancy, square)
+                                                     : queen_attacks(occupancy, square);
+        }
+      }
+      ASSERT_EQ(maps.by_piece[BISHOP], sliders[0]);
+      ASSERT_EQ(maps.by_piece[ROOK], sliders[1]);
+      ASSERT_EQ(maps.by_piece[QUEEN], sliders[2]);
+
+      // Attacked by white is what black has to avoid
+      for (int square = 0; square < 64; square++)
+      {
+        ASSERT_EQ(bool(maps.all & int_location_to_bitboard(square)), is_square_attacked(!white, square, position))
+            << int_to_square_string(square);
+      }
+    }
+  };
+
+  for (const std::string& fen : fens)
+  {
+    Position pos = Util::Initializers::fen_string_to_position(fen);
+    expect_maps_match(&pos);
+    for (uint32_t move : valid_moves_for_position(pos))
+    {
+      Position after = make_move(&pos, move);
+      expect_maps_match(&after);
+    }
+  }
+}
+
+TEST_F(MovesTest, CountLegalMovesMatchesGenerator)
+{
+  // Pins, en passant, promotions, double checks and castling all occur within two plies of these
+  std::vector<std::string> fens = {
+      "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+      "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+      "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+      "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+  };
+
+  for (const std::string& fen : fens)
+  {
+    Position pos = Util::Initializers::fen_string_to_position(fen);
+    EXPECT_EQ(count_legal_moves(&pos), valid_moves_for_position(pos).size()) << fen;
+    for (uint32_t move : valid_moves_for_position(pos))
+    {
+      Position after = make_move(&pos, move);
+      for (uint32_t reply : valid_moves_for_position(after))
+      {
+        Position after_reply = make_move(&after, reply);
+        ASSERT_EQ(count_legal_moves(&after_reply), valid_moves_for_position(after_reply).size())
+            << fen << " " << uint_move_to_engine_string_move(move) << " " << uint_move_to_engine_string_move(reply);
+      }
+    }
+  }
+}
+
+TEST_F(MovesTest, UndoMoveRestoresPosition)
+{
+  std::vector<std::string> fens = {
+      "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+      "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+      "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+  };
+
+  for (const std::string& fen : fens)
+  {
+    Position pos = Util::Initializers::fen_string_to_position(fen);
+    for (uint32_t move : valid_moves_for_position(pos))
+    {
+      Position played = pos;
+      StateInfo state;
+      do_move(&played, move, &state);
+      EXPECT_EQ(played, make_move(&pos, move)) << fen << " " << uint_move_to_engine_string_move(move);
+
+      for (uint32_t reply : valid_moves_for_position(played))
+      {
+        Position before_reply = played;
+        StateInfo reply_state;
+        do_move(&played, reply, &reply_state);
+        EXPECT_EQ(played.hash, zobrist::compute_hash(played));
+        undo_move(&played, reply, reply_state);
+        EXPECT_EQ(played, before_reply) << fen << " " << uint_move_to_engine_string_move(reply);
+      }
+
+      undo_move(&played, move, state);
+      EXPECT_EQ(played, pos) << fen << " " << uint_move_to_engine_string_move(move);
+    }
+  }
+}
+
+TEST_F(MovesTest, LegalityCheckMatchesGenerator)
+{
+  // Moves generated in sibling positions stand in for stale TT and killer moves
+  std::vector<std::string> fens = {
+      "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+      "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+      "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+  };
+
+  for (const std::string& fen : fens)
+  {
+    Position pos = Util::Initializers::fen_string_to_position(fen);
+    MoveList root_moves = valid_moves_for_position(pos);
+
+    for (uint32_t move : root_moves)
+    {
+      Position after = make_move(&pos, move);
+      MoveList legal = valid_moves_for_position(after);
+
+      // The other side's moves too, killers are shared between plies of both colors
+      std::vector<uint32_t> candidates(legal.begin(), legal.end());
+      candidates.insert(candidates.end(), root_moves.begin(), root_moves.end());
+      for (uint32_t sibling_move : root_moves)
+      {
+        Position sibling = make_move(&pos, sibling_move);
+        for (uint32_t candidate : valid_moves_for_position(sibling))
+        {
+          candidates.push_back(candidate);
+        }
+      }
+
+      for (uint32_t candidate : candidates)
+      {
+        bool generated = std::any_of(legal.begin(), legal.end(),
+                                     [candidate](uint32_t legal_move) { return same_move(legal_move, candidate); });
+        EXPECT_EQ(is_legal_move(&after, candidate), generated)
+            << fen << " " << uint_move_to_engine_string_move(move) << " " << uint_move_to_engine_string_move(candidate);
+      }
+    }
+  }
+}
+
+TEST_F(MovesTest, GenerationTypesPartitionLegalMoves)
+{
+  std::vector<std::string> fens = {
+      "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+      "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+      "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+  };
+
+  auto sorted = [](const MoveList& moves)
+  {
+    std::vector<uint32_t> result(moves.begin(), moves.end());
+    std::sort(result.begin(), result.end());
+    return result;
+  };
+
+  for (const std::string& fen : fens)
+  {
+    Position root = Util::Initializers::fen_string_to_position(fen);
+    for (uint32_t root_move : valid_moves_for_position(root))
+    {
+      Position pos = make_move(&root, root_move);
+      std::vector<uint32_t> legal = sorted(valid_moves_for_position(pos));
+
+      if (is_in_check(&pos))
+      {
+        EXPECT_EQ(sorted(generate_moves(&pos, EVASIONS)), legal) << fen << " " << uint_move_to_engine_string_move(root_move);
+      }
+
+      MoveList captures = generate_moves(&pos, CAPTURES);
+      MoveList quiets = generate_moves(&pos, QUIETS);
+      std::vector<uint32_t> quiet_checks;
+      for (uint32_t move : captures)
+      {
+        EXPECT_TRUE(decode_capture(move) || decode_promoted_to_piece(move) != NO_PIECE);
+      }
+      for (uint32_t move : quiets)
+      {
+        EXPECT_FALSE(decode_capture(move) || decode_promoted_to_piece(move) != NO_PIECE);
+        if (decode_check(move))
+        {
+          quiet_checks.push_back(move);
+        }
+      }
+
+      MoveList combined = captures;
+      for (uint32_t move : quiets)
+      {
+        combined.push_back(move);
+      }
+      std::sort(quiet_checks.begin(), quiet_checks.end());
+      EXPECT_EQ(sorted(combined), legal) << fen << " " << uint_move_to_engine_string_move(root_move);
+      EXPECT_EQ(sorted(generate_moves(&pos, QUIET_CHECKS)), quiet_checks)
+          << fen << " " << uint_move_to_engine_string_move(root_move);
+    }
+  }
+}
@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+
+#include "../../src/game/moves.hpp"
+#include "../../src/perft/perft.hpp"
+#include "../../src/util/initializers.hpp"
+#include "../../src/util/zobrist.hpp"
+
+class PerftTest : public ::testing::Test
+{
+protected:
+  void SetUp() override { zobrist::init(); }
+
+  const std::string kiwipete = "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1";
+};
+
+TEST_F(PerftTest, CountNodesMatchesKnownCounts)
+{
+  Position position = Util::Initializers::fen_string_to_position(kiwipete);
+  EXPECT_EQ(perft::count_nodes(&position, 0), 1u);
+  EXPECT_EQ(perft::count_nodes(&position, 1), 48u);
+  EXPECT_EQ(perft::count_nodes(&position, 3), 97862u);
+}
+
+TEST_F(PerftTest, ThreadedDivideMatchesSingleThreaded)
+{
+  // Four threads split the 48 root moves into their replies, one thread does not split at all
+  Position position = Util::Initializers::fen_string_to_position(kiwipete);
+  perft::PerftResult single = perft::run(&position, 4, 1);
+  perft::PerftResult threaded = perft::run(&position, 4, 4);
+
+  EXPECT_EQ(single.nodes, 4085603u);
+  EXPECT_EQ(threaded.nodes, single.nodes);
+  ASSERT_EQ(threaded.divide.size(), single.divide.size());
+  for (size_t i = 0; i < single.divide.size(); i++)
+  {
+    EXPECT_EQ(threaded.divide[i].move, single.divide[i].move);
+    EXPECT_EQ(threaded.divide[i].nodes, single.divide[i].nodes)
+        << uint_move_to_engine_string_move(single.divide[i].move);
+  }
+}
+
+TEST_F(PerftTest, HashedCountsMatchUnhashed)
+{
+  // A table small enough that entries are overwritten while threads race on them
+  Position position = Util::Initializers::fen_string_to_position(kiwipete);
+  perft::HashTable table(1);
+  EXPECT_EQ(perft::count_nodes(&position, 4, &table), 4085603u);
+  EXPECT_EQ(perft::count_nodes(&position, 4, &table), 4085603u);
+
+  perft::PerftResult unhashed = perft::run(&position, 4, 4);
+  perft::PerftResult hashed = perft::run(&position, 4, 4, 1);
+  EXPECT_EQ(hashed.nodes, unhashed.nodes);
+  for (size_t i = 0; i < unhashed.divide.size(); i++)
+  {
+    EXPECT_EQ(hashed.divide[i].nodes, unhashed.divide[i].nodes);
+  }
+}
+
+TEST_F(PerftTest, ParsesEpdSuiteLines)
+{
+  perft::SuiteEntry entry = perft::parse_epd_line(kiwipete + " ;D1 48 ;D2 2039");
+  EXPECT_EQ(entry.fen, kiwipete);
+  ASSERT_EQ(entry.expected.size(), 2u);
+  EXPECT_EQ(entry.expected[1].first, 2);
+  EXPECT_EQ(entry.expected[1].second, 2039u);
+
+  // Move counters are optional and spacing around fields is loose
+  entry = perft::parse_epd_line("8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - -;D1  14 ; D3 2812 ;");
+  EXPECT_EQ(entry.fen, "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1");
+  ASSERT_EQ(entry.expected.size(), 2u);
+  EXPECT_EQ(entry.expected[1].first, 3);
+
+  EXPECT_THROW(perft::parse_epd_line("8/8/8 w ;D1 1"), std::invalid_argument);
+  EXPECT_THROW(perft::parse_epd_line(kiwipete + " ;X1 48"), std::invalid_argument);
+}
+
+TEST_F(PerftTest, StatsMatchKnownCounts)
+{
+  Position start = Util::Initializers::starting_position();
+  perft::PerftStats stats = perft::count_stats(&start, 5);
+  EXPECT_EQ(stats.nodes, 4865609u);
+  EXPECT_EQ(stats.captures, 82719u);
+  EXPECT_EQ(stats.en_passants, 258u);
+  EXPECT_EQ(stats.castles, 0u);
+  EXPECT_EQ(stats.checks, 27351u);
+  EXPECT_EQ(stats.checkmates, 347u);
+
+  Position position = Util::Initializers::fen_string_to_position(kiwipete);
+  perft::PerftResult result = perft::run(&position, 3, 4, 16, true);
+  EXPECT_EQ(result.nodes, 97862u);
+  EXPECT_EQ(result.stats.nodes, 97862u);
+  EXPECT_EQ(result.stats.captures, 17102u);
+  EXPECT_EQ(result.stats.en_passants, 45u);
+  EXPECT_EQ(result.stats.castles, 3162u);
+  EXPECT_EQ(result.stats.promotions, 0u);
+  EXPECT_EQ(result.stats.checks, 993u);
+  EXPECT_EQ(result.stats.checkmates, 1u);
+
+  EXPECT_EQ(perft::run(&position, 1, 1, 0, true).stats.castles, 2u);
+}
+
+TEST_F(PerftTest, CheckmatesAreNotStalemates)
+{
+  // Qc8 mates, while Qc7 and Qf4 leave black no move without giving check
+  Position position = Util::Initializers::fen_string_to_position("k7/8/1K6/8/8/8/8/2Q5 w - - 0 1");
+  int no_replies = 0;
+  for (uint32_t move : generate_moves(&position, ALL_LEGAL))
+  {
+    Position after = make_move(&position, move);
+    no_replies += count_legal_moves(&after) == 0;
+  }
+
+  EXPECT_EQ(no_replies, 3);
+  EXPECT_EQ(perft::count_stats(&position, 1).checkmates, 1u);
+}
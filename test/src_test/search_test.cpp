@@ -0,0 +1,193 @@
+#include <gtest/gtest.h>
+
+#include "../../src/game/moves.hpp"
+#include "../../src/search/search.hpp"
+#include "../../src/search/transposition.hpp"
+#include "../../src/util/initializers.hpp"
+#include "../../src/util/zobrist.hpp"
+
+// Workers, and so the per-thread tables and node counters, never share a cache line
+static_assert(alignof(SearchWorker) == CACHE_LINE_SIZE);
+
+class SearchTest : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    zobrist::init();
+    TT.clear();
+    search_context.clear();
+    set_search_time_limit(20);
+  }
+
+  void TearDown() override
+  {
+    set_thread_count(1);
+    set_multi_pv(1);
+  }
+
+  bool is_legal(Position* position, uint32_t move)
+  {
+    MoveList moves = generate_moves(position, ALL_LEGAL);
+    return std::any_of(moves.begin(), moves.end(), [&](uint32_t legal) { return same_move(legal, move); });
+  }
+
+  const std::string kiwipete = "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1";
+};
+
+TEST_F(SearchTest, ParkedThreadsSearchAgain)
+{
+  // The same threads take every search, including after the count changes between them
+  Position position = Util::Initializers::fen_string_to_position(kiwipete);
+  for (int threads : {3, 3, 1, 2})
+  {
+    set_thread_count(threads);
+    find_move_return_val result = find_move(&position);
+    EXPECT_TRUE(is_legal(&position, result.best_move));
+    EXPECT_GT(result.depth, 0);
+    EXPECT_GT(result.nodes, 0u);
+    EXPECT_GE(result.first_info_latency.count(), 0);
+  }
+}
+
+TEST_F(SearchTest, StartSearchReportsOnceWhenDone)
+{
+  set_thread_count(2);
+  Position position = Util::Initializers::fen_string_to_position(kiwipete);
+
+  int reports = 0;
+  uint32_t reported_move = 0;
+  start_search(position, [&](const find_move_return_val& result) {
+    reports++;
+    reported_move = result.best_move;
+  });
+  wait_for_search();
+
+  EXPECT_EQ(reports, 1);
+  EXPECT_TRUE(is_legal(&position, reported_move));
+}
+
+TEST_F(SearchTest, NodeLimitIsExactAndRepeatable)
+{
+  // From the same TT and tables the same work gives the same move and score
+  auto fresh_search = [](Position* position) {
+    TT.clear();
+    search_context.clear();
+    clear_search_tables();
+    return find_move(position);
+  };
+
+  Position position = Util::Initializers::fen_string_to_position(kiwipete);
+  set_search_limits({.nodes = 30000});
+  find_move_return_val first = fresh_search(&position);
+  find_move_return_val second = fresh_search(&position);
+
+  EXPECT_EQ(first.nodes, 30000u);
+  EXPECT_EQ(second.nodes, first.nodes);
+  EXPECT_EQ(second.best_move, first.best_move);
+  EXPECT_EQ(second.position_score, first.position_score);
+  EXPECT_EQ(second.depth, first.depth);
+}
+
+TEST_F(SearchTest, DepthLimitStopsAtDepth)
+{
+  Position position = Util::Initializers::fen_string_to_position(kiwipete);
+  set_search_limits({.time_ms = 1000000000, .depth = 4});
+
+  find_move_return_val result = find_move(&position);
+  EXPECT_EQ(result.depth, 4);
+  EXPECT_TRUE(is_legal(&position, result.best_move));
+}
+
+TEST_F(SearchTest, TinyNodeLimitStillPlaysALegalMove)
+{
+  Position position = Util::Initializers::fen_string_to_position(kiwipete);
+  set_search_limits({.nodes = 1});
+  EXPECT_TRUE(is_legal(&position, find_move(&position).best_move));
+}
+
+TEST_F(SearchTest, OptimumTimeEndsSearchLongBeforeMaximum)
+{
+  // No iteration starts past the scaled optimum, so the one running then is the last and the maximum is never reached
+  Position position = Util::Initializers::fen_string_to_position(kiwipete);
+  set_search_limits({.time_ms = 60000, .optimum_ms = 30});
+
+  find_move_return_val result = find_move(&position);
+  EXPECT_LT(result.miliseconds_of_search_time.count(), 5000);
+  EXPECT_GE(result.depth, 1);
+  EXPECT_TRUE(is_legal(&position, result.best_move));
+}
+
+TEST_F(SearchTest, RepeatingFromGameHistoryIsADraw)
+{
+  // A rook down, white can only hold by playing Nf3 into a position the game has already had twice
+  Position position = Util::Initializers::fen_string_to_position("r3k3/8/8/8/8/8/8/4K1N1 w - - 0 1");
+  std::vector<uint64_t> history = {position.hash};
+  for (int cycle = 0; cycle < 2; cycle++)
+  {
+    for (std::string played : {"g1f3", "e8d8", "f3g1", "d8e8"})
+    {
+      for (uint32_t move : generate_moves(&position, ALL_LEGAL))
+      {
+        if (uint_move_to_engine_string_move(move) == played)
+        {
+          position = make_move(&position, move);
+          break;
+        }
+      }
+      history.push_back(position.hash);
+    }
+  }
+  ASSERT_EQ(position.half_move_clock, 8);
+
+  set_search_limits({.time_ms = 1000000000, .depth = 4});
+  find_move_return_val result = find_move_with_history(&position, history);
+  EXPECT_EQ(uint_move_to_engine_string_move(result.best_move), "g1f3");
+  EXPECT_EQ(result.position_score, 0);
+}
+
+TEST_F(SearchTest, PrincipalVariationIsAPlayableLine)
+{
+  Position position = Util::Initializers::fen_string_to_position(kiwipete);
+  set_search_limits({.time_ms = 1000000000, .depth = 6});
+
+  find_move_return_val result = find_move(&position);
+  ASSERT_GE(result.principal_variation.size(), 2u);
+  EXPECT_LE(result.principal_variation.size(), static_cast<size_t>(MAX_PV_LENGTH));
+  EXPECT_EQ(result.principal_variation[0], result.best_move);
+
+  // Each move is legal in the position the ones before it lead to
+  for (uint32_t move : result.principal_variation)
+  {
+    ASSERT_TRUE(is_legal(&position, move)) << uint_move_to_engine_string_move(move);
+    position = make_move(&position, move);
+  }
+}
+
+TEST_F(SearchTest, MultiPvReportsDistinctLinesBestFirst)
+{
+  Position position = Util::Initializers::fen_string_to_position(kiwipete);
+  set_search_limits({.time_ms = 1000000000, .depth = 5});
+  set_multi_pv(4);
+
+  find_move_return_val result = find_move(&position);
+  ASSERT_EQ(result.lines.size(), 4u);
+  EXPECT_EQ(result.lines[0].move, result.best_move);
+  EXPECT_EQ(result.lines[0].score, result.position_score);
+
+  for (size_t i = 0; i < result.lines.size(); i++)
+  {
+    EXPECT_TRUE(is_legal(&position, result.lines[i].move));
+    EXPECT_EQ(result.lines[i].pv[0], result.lines[i].move);
+    for (size_t j = 0; j < i; j++)
+    {
+      EXPECT_FALSE(same_move(result.lines[i].move, result.lines[j].move));
+      EXPECT_GE(result.lines[j].score, result.lines[i].score);
+    }
+  }
+
+  // More lines than moves gives one line per move
+  Position few_moves = Util::Initializers::fen_string_to_position("k7/8/1K6/8/8/8/8/2Q5 b - - 0 1");
+  set_multi_pv(10);
+  EXPECT_EQ(find_move(&few_moves).lines.size(), generate_moves(&few_moves, ALL_LEGAL).size());
+}
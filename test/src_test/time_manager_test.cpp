@@ -0,0 +1,37 @@
+#include <gtest/gtest.h>
+
+#include "../../src/uci/time_manager.hpp"
+
+TEST(TimeManagerTest, ClockGivesOptimumWithinMaximum)
+{
+  TimeControl tc;
+  tc.wtime = 60000;
+  tc.winc = 1000;
+
+  TimeBudget budget = TimeManager::allocate_time(tc, true, 20);
+  EXPECT_GT(budget.optimum_ms, 0);
+  EXPECT_GT(budget.maximum_ms, budget.optimum_ms);
+  EXPECT_LT(budget.maximum_ms, tc.wtime);
+
+  // Nearly out of time the maximum still leaves some of the clock
+  tc.wtime = 200;
+  tc.winc = 0;
+  budget = TimeManager::allocate_time(tc, true, 20);
+  EXPECT_LE(budget.optimum_ms, budget.maximum_ms);
+  EXPECT_LT(budget.maximum_ms, tc.wtime);
+}
+
+TEST(TimeManagerTest, FixedTimeHasNoOptimum)
+{
+  TimeControl tc;
+  tc.movetime = 1000;
+  tc.wtime = 60000;
+
+  TimeBudget budget = TimeManager::allocate_time(tc, true, 20);
+  EXPECT_EQ(budget.optimum_ms, 0);
+  EXPECT_EQ(budget.maximum_ms, 1000 - 50);
+
+  tc.clear();
+  tc.infinite = true;
+  EXPECT_EQ(TimeManager::allocate_time(tc, true, 20).optimum_ms, 0);
+}
@@ -0,0 +1,36 @@
+#include "../../../src/util/global.hpp"
+
+#include <gtest/gtest.h>
+
+// Tables are generated at compile time with these
+static_assert(bitscan(1ull << 63) == 63);
+static_assert(bitcount(0xff00ff00ff00ff00ull) == 32);
+
+// ------------------------------------------------------------------------------------------------
+// Bit intrinsic tests
+// ------------------------------------------------------------------------------------------------
+TEST(BitIntrinsics, BitscanFindsLowestBit)
+{
+  for (int square = 0; square < 64; square++)
+  {
+    EXPECT_EQ(bitscan(1ull << square), square);
+    EXPECT_EQ(bitscan(~0ull << square), square);
+  }
+  EXPECT_EQ(bitscan(0), 0);
+}
+
+TEST(BitIntrinsics, BitcountCountsSetBits)
+{
+  EXPECT_EQ(bitcount(0), 0);
+  EXPECT_EQ(bitcount(~0ull), 64);
+  EXPECT_EQ(bitcount(0x8000000000000001ull), 2);
+}
+
+TEST(BitIntrinsics, PopLsbVisitsSquaresInOrder)
+{
+  uint64_t bitboard = (1ull << 3) | (1ull << 17) | (1ull << 63);
+  EXPECT_EQ(pop_lsb(bitboard), 3);
+  EXPECT_EQ(pop_lsb(bitboard), 17);
+  EXPECT_EQ(pop_lsb(bitboard), 63);
+  EXPECT_EQ(bitboard, 0ull);
+}
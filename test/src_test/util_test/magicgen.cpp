@@ -132,3 +132,78 @@
 // //   // on e5
 // //   EXPECT_EQ(rook_attack_masks[61], 16077885992062689312ull);
 // // }
+
+#include <gtest/gtest.h>
+
+#include "../../../src/util/magicbitboards.hpp"
+
+// ------------------------------------------------------------------------------------------------
+// Slider attack backend tests
+// ------------------------------------------------------------------------------------------------
+TEST(SliderAttacks, MagicMatchesReference)
+{
+  // Every blocker subset of every square, with pieces outside the mask that must be ignored
+  for (int square = 0; square < 64; square++)
+  {
+    uint64_t bitboard = 1ull << square;
+    for (int i = 0; i < (1 << rook_occupancy[square]); i++)
+    {
+      uint64_t occupancy = construct_occupancies(i, rook_occupancy[square], rook_full_occupancy[square]);
+      EXPECT_EQ(rook_attacks_magic(occupancy | ~rook_full_occupancy[square], square),
+                rook_attack_mask_for_bitboard(bitboard, occupancy));
+    }
+    for (int i = 0; i < (1 << bishop_occupancy[square]); i++)
+    {
+      uint64_t occupancy = construct_occupancies(i, bishop_occupancy[square], bishop_full_occupancy[square]);
+      EXPECT_EQ(bishop_attacks_magic(occupancy | ~bishop_full_occupancy[square], square),
+                bishop_attack_mask_for_bitboard(bitboard, occupancy));
+    }
+  }
+}
+
+TEST(SliderAttacks, PextMatchesMagic)
+{
+  if (!pext_supported())
+  {
+    GTEST_SKIP() << "CPU has no BMI2";
+  }
+
+  uint64_t random_state = 0x9e3779b97f4a7c15ull;
+  for (int i = 0; i < 20000; i++)
+  {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 7;
+    random_state ^= random_state << 17;
+
+    // Sparse and dense boards both occur in games
+    uint64_t occupancy = i % 2 ? random_state : random_state & (random_state >> 17);
+    for (int square = 0; square < 64; square++)
+    {
+      ASSERT_EQ(rook_attacks_pext(occupancy, square), rook_attacks_magic(occupancy, square));
+      ASSERT_EQ(bishop_attacks_pext(occupancy, square), bishop_attacks_magic(occupancy, square));
+    }
+  }
+}
+
+TEST(SliderAttacks, BackendFollowsCpuSupport)
+{
+  if (!pext_supported())
+  {
+    EXPECT_EQ(slider_backend, MAGIC);
+  }
+
+  // Slow PEXT keeps magics unless forced, and nothing forces PEXT onto a CPU without it
+  EXPECT_EQ(pick_slider_backend(true, true, nullptr), PEXT);
+  EXPECT_EQ(pick_slider_backend(true, false, nullptr), MAGIC);
+  EXPECT_EQ(pick_slider_backend(true, false, "pext"), PEXT);
+  EXPECT_EQ(pick_slider_backend(true, true, "magic"), MAGIC);
+  EXPECT_EQ(pick_slider_backend(true, true, "other"), PEXT);
+  EXPECT_EQ(pick_slider_backend(false, true, "pext"), MAGIC);
+}
+
+TEST(SliderAttacks, PackedTablesHoldOneEntryPerSubset)
+{
+  // 64 * 4096 and 64 * 512 entries before packing
+  EXPECT_EQ(slider_table_size<true>(), 102400u);
+  EXPECT_EQ(slider_table_size<false>(), 5248u);
+}
@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <iterator>
+
 #include "../../src/game/moves.hpp"
 #include "../../src/util/initializers.hpp"
 #include "../../src/util/zobrist.hpp"
@@ -20,7 +23,7 @@ TEST_F(ZobristTest, HashConsistencyAfterMove)
   EXPECT_EQ(pos.hash, computed_hash) << "Initial hash should match computed hash";
 
   // Get all legal moves
-  std::vector<uint32_t> moves = valid_moves_for_position(pos);
+  MoveList moves = valid_moves_for_position(pos);
   ASSERT_FALSE(moves.empty()) << "Starting position should have legal moves";
 
   // Make each move and verify hash consistency
@@ -49,7 +52,7 @@ TEST_F(ZobristTest, HashConsistencyMultipleMoves)
     int from_sq = string_to_int(move_str.substr(0, 2));
     int to_sq = string_to_int(move_str.substr(2, 2));
 
-    std::vector<uint32_t> moves = valid_moves_for_position(pos);
+    MoveList moves = valid_moves_for_position(pos);
     bool found = false;
 
     for (uint32_t move : moves)
@@ -74,7 +77,7 @@ TEST_F(ZobristTest, DifferentPositionsDifferentHashes)
   Position pos1 = Util::Initializers::starting_position();
 
   // Make e4
-  std::vector<uint32_t> moves = valid_moves_for_position(pos1);
+  MoveList moves = valid_moves_for_position(pos1);
   Position pos2 = pos1;
 
   for (uint32_t move : moves)
@@ -98,3 +101,33 @@ TEST_F(ZobristTest, FenPositionHash)
   uint64_t computed_hash = zobrist::compute_hash(pos);
   EXPECT_EQ(pos.hash, computed_hash) << "FEN-parsed position hash should match computed hash";
 }
+
+TEST_F(ZobristTest, CuckooTableHoldsEveryReversibleMove)
+{
+  // Knight, bishop, rook, queen and king moves between two squares on an empty board, for both colors
+  int stored = std::count_if(std::begin(zobrist::cuckoo_keys), std::end(zobrist::cuckoo_keys),
+                             [](uint64_t key) { return key != 0; });
+  EXPECT_EQ(stored, 3668);
+
+  // Ng1-f3 and back differ by the key of the move in either direction
+  Position start = Util::Initializers::starting_position();
+  for (uint32_t move : valid_moves_for_position(start))
+  {
+    if (decode_from_square(move) == g1 && decode_to_square(move) == f3)
+    {
+      Position after = make_move(&start, move);
+      const zobrist::ReversibleMove* found = zobrist::find_reversible_move(start.hash ^ after.hash);
+      ASSERT_NE(found, nullptr);
+      EXPECT_EQ(found->piece, KNIGHT);
+      EXPECT_EQ(std::min(found->from, found->to), f3);
+      EXPECT_EQ(std::max(found->from, found->to), g1);
+    }
+
+    // A pawn push can never be undone
+    if (decode_from_square(move) == e2 && decode_to_square(move) == e3)
+    {
+      Position after = make_move(&start, move);
+      EXPECT_EQ(zobrist::find_reversible_move(start.hash ^ after.hash), nullptr);
+    }
+  }
+}